@@ -0,0 +1,3 @@
+add_executable(diagon_benchmark src/benchmark.cpp)
+target_link_libraries(diagon_benchmark PRIVATE diagon_lib screen)
+target_set_common(diagon_benchmark)
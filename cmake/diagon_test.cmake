@@ -2,41 +2,27 @@ add_executable(input_output_test src/input_output_test.cpp)
 target_link_libraries(input_output_test diagon_lib)
 target_set_common(input_output_test)
 
-option(DIAGON_ASAN "Set to ON to enable address sanitizer" OFF)
-option(DIAGON_LSAN "Set to ON to enable leak sanitizer" OFF)
-option(DIAGON_MSAN "Set to ON to enable memory sanitizer" OFF)
-option(DIAGON_TSAN "Set to ON to enable thread sanitizer" OFF)
-option(DIAGON_UBSAN "Set to ON to enable undefined behavior sanitizer" OFF)
-if (NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
-  return()
-endif()
+add_executable(screen_test src/screen_test.cpp)
+target_link_libraries(screen_test screen)
+target_set_common(screen_test)
 
-# Add ASAN
-if (DIAGON_ASAN)
-  add_compile_options(-fsanitize=address)
-  add_link_options(-fsanitize=address)
-endif()
+add_executable(translator_test src/translator_test.cpp)
+target_link_libraries(translator_test diagon_lib)
+target_set_common(translator_test)
 
-# Add LSAN
-if (DIAGON_LSAN)
-  add_compile_options(-fsanitize=leak)
-  add_link_options(-fsanitize=leak)
-endif()
+# Same tests, translated from several threads at once.
+find_package(Threads REQUIRED)
+add_executable(concurrency_test src/concurrency_test.cpp)
+target_link_libraries(concurrency_test diagon_lib Threads::Threads)
+target_set_common(concurrency_test)
 
-# Add MSAN
-if (DIAGON_MSAN)
-  add_compile_options(-fsanitize=memory)
-  add_link_options(-fsanitize=memory)
-endif()
-
-# Add TSAN
-if (DIAGON_TSAN)
-  add_compile_options(-fsanitize=thread)
-  add_link_options(-fsanitize=thread)
-endif()
-
-# Add UBSAN
-if (DIAGON_UBSAN)
-  add_compile_options(-fsanitize=undefined)
-  add_link_options(-fsanitize=undefined)
-endif()
+# Run with `ctest`. Configure with -DDIAGON_TSAN=ON to check concurrency_test
+# for data races.
+enable_testing()
+foreach(test
+    input_output_test
+    screen_test
+    translator_test
+    concurrency_test)
+  add_test(NAME ${test} COMMAND ${test})
+endforeach()
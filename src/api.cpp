@@ -47,7 +47,7 @@ json API(const Translator::Example& example) {
   return json;
 }
 
-json API(const TranslatorPtr& translator) {
+json API(Translator* translator) {
   auto json = json::object();
   json["tool"] = translator->Identifier();
   json["description"] = translator->Name();
@@ -0,0 +1,306 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include <chrono>
+#include <codecvt>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "screen/Screen.h"
+#include "translator/Factory.h"
+
+TranslatorPtr FrameTranslator();
+TranslatorPtr GrammarTranslator();
+TranslatorPtr GraphDAGTranslator();
+TranslatorPtr GraphPlanarTranslator();
+TranslatorPtr MathTranslator();
+TranslatorPtr SequenceTranslator();
+TranslatorPtr TableTranslator();
+TranslatorPtr TreeTranslator();
+TranslatorPtr FlowchartTranslator();
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define DIAGON_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DIAGON_HAS_RDTSC
+#endif
+
+namespace {
+
+struct Measure {
+  double nanoseconds = 0;
+  double cycles = 0;
+};
+
+// Run |function| repeatedly for about half a second, and return the average
+// cost of one run.
+Measure Run(const std::function<void()>& function) {
+  using Clock = std::chrono::steady_clock;
+  function();  // Warm up.
+
+  int iterations = 0;
+  auto start = Clock::now();
+#if defined(DIAGON_HAS_RDTSC)
+  uint64_t start_cycles = __rdtsc();
+#endif
+  auto elapsed = Clock::duration();
+  while (elapsed < std::chrono::milliseconds(500)) {
+    function();
+    ++iterations;
+    elapsed = Clock::now() - start;
+  }
+
+  Measure measure;
+  measure.nanoseconds =
+      std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+#if defined(DIAGON_HAS_RDTSC)
+  measure.cycles = double(__rdtsc() - start_cycles) / iterations;
+#endif
+  return measure;
+}
+
+// |items| is the amount of processed data: bytes, or cells.
+void Report(const char* name, size_t items, Measure measure) {
+  std::printf("  %-28s %10.0f ns %8.3f items/ns", name, measure.nanoseconds,
+              items / measure.nanoseconds);
+  if (measure.cycles)
+    std::printf(" %8.3f items/cycle", items / measure.cycles);
+  std::printf("\n");
+}
+
+// A large canvas, similar to what GraphDAG produces: mostly blank with boxes,
+// lines and labels.
+Screen MakeCanvas(Screen::Storage storage = Screen::Storage::Wide) {
+  const int width = 2000;
+  const int height = 500;
+  Screen screen(width, height, storage);
+  for (int y = 0; y + 3 <= height; y += 5) {
+    for (int x = 0; x + 16 <= width; x += 20) {
+      screen.DrawBoxedText(x, y, L"node_label__");
+      screen.DrawVerticalLine(y + 3, y + 4, x + 6);
+    }
+  }
+  return screen;
+}
+
+// The encoder used before: one std::wstring_convert per line, and a
+// std::stringstream to join them.
+std::string LegacyToString(Screen& screen) {
+  std::stringstream ss;
+  for (int y = 0; y < screen.height(); ++y) {
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    ss << converter.to_bytes(std::wstring(screen.Line(y))) << '\n';
+  }
+  return ss.str();
+}
+
+void BenchmarkToString() {
+  std::printf("Screen::ToString (UTF-8 encoding):\n");
+  Screen screen = MakeCanvas();
+  size_t bytes = screen.ToString().size();
+  Report("before (wstring_convert)", bytes,
+         Run([&] { LegacyToString(screen); }));
+  Report("after (Utf8Encode)", bytes, Run([&] { screen.ToString(); }));
+}
+
+// The ASCIIfy(0) used before: a switch over every cell.
+void LegacyASCIIfy(Screen& screen) {
+  for (int y = 0; y < screen.height(); ++y) {
+    for (int x = 0; x < screen.width(); ++x) {
+      auto c = screen.Pixel(x, y);
+      // clang-format off
+      switch (c) {
+        case L'─': c = '-'; break;
+        case L'│': c = '|'; break;
+        case L'┐': c = '.'; break;
+        case L'┘': c = '\''; break;
+        case L'┌': c = '.'; break;
+        case L'└': c = '\''; break;
+        case L'┬': c = '-'; break;
+        case L'┴': c = '-'; break;
+        case L'├': c = '-'; break;
+        case L'┤': c = '-'; break;
+        case L'△': c = '^'; break;
+        case L'▽': c = 'V'; break;
+      }
+      // clang-format on
+    }
+  }
+}
+
+void BenchmarkASCIIfy() {
+  std::printf("Screen::ASCIIfy (includes copying the canvas):\n");
+  const Screen canvas = MakeCanvas();
+  size_t cells = size_t(canvas.width()) * canvas.height();
+  Report("copy only", cells, Run([&] { Screen screen = canvas; }));
+  Report("before (switch)", cells, Run([&] {
+           Screen screen = canvas;
+           LegacyASCIIfy(screen);
+         }));
+  Report("after (Charset)", cells, Run([&] {
+           Screen screen = canvas;
+           screen.ASCIIfy(0);
+         }));
+}
+
+void BenchmarkCompact() {
+  std::printf("Screen::Storage::Compact (draw and encode the canvas):\n");
+  const Screen canvas = MakeCanvas();
+  size_t cells = size_t(canvas.width()) * canvas.height();
+  std::printf("  cells: %zu bytes wide, %zu bytes compact\n",
+              cells * sizeof(wchar_t), cells * sizeof(uint8_t));
+  Report("wide", cells, Run([&] { MakeCanvas().ToString(); }));
+  Report("compact", cells, Run([&] {
+           MakeCanvas(Screen::Storage::Compact).ToString();
+         }));
+}
+
+void BenchmarkDiff() {
+  std::printf("Screen::Diff (one box drawn since the previous screen):\n");
+  const Screen previous = MakeCanvas();
+  previous.Diff(previous);  // Compute the hashes once.
+  size_t cells = size_t(previous.width()) * previous.height();
+  Report("ToString", cells, Run([&] {
+           Screen screen = previous;
+           screen.DrawBoxedText(10, 10, L"edited");
+           screen.ToString();
+         }));
+  Report("Diff", cells, Run([&] {
+           Screen screen = previous;
+           screen.DrawBoxedText(10, 10, L"edited");
+           screen.Diff(previous);
+         }));
+}
+
+// A huge and mostly blank canvas, similar to what GraphPlanar produces: boxes
+// along the diagonal.
+Screen MakeSparseCanvas(Screen::Storage storage) {
+  const int width = 20000;
+  const int height = 5000;
+  Screen screen(width, height, storage);
+  for (int i = 0; i + 3 <= height; i += 4)
+    screen.DrawBoxedText(i * 3, i, L"node_label__");
+  return screen;
+}
+
+void BenchmarkSparse() {
+  std::printf("Screen::Storage::Sparse (draw and encode a blank canvas):\n");
+  size_t cells = size_t(20000) * 5000;
+  Report("wide", cells, Run([&] {
+           MakeSparseCanvas(Screen::Storage::Wide).ToString();
+         }));
+  Report("sparse", cells, Run([&] {
+           MakeSparseCanvas(Screen::Storage::Sparse).ToString();
+         }));
+}
+
+void BenchmarkToWString() {
+  std::printf("to_wstring (UTF-8 decoding):\n");
+  std::string input = MakeCanvas().ToString();
+  Report("before (wstring_convert)", input.size(), Run([&] {
+           std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+           converter.from_bytes(input);
+         }));
+  Report("after (Utf8Decode)", input.size(), Run([&] { to_wstring(input); }));
+
+  // Mostly ASCII, like a large Table input.
+  std::string csv;
+  for (int i = 0; i < 100000; ++i)
+    csv += "Javascript,CSS,HTML,C++,Web,Assembly\n";
+  Report("before (wstring_convert) csv", csv.size(), Run([&] {
+           std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+           converter.from_bytes(csv);
+         }));
+  Report("after (Utf8Decode) csv", csv.size(), Run([&] { to_wstring(csv); }));
+}
+
+// The registry used before: every translator constructed up front, then a
+// linear search over their identifiers.
+Translator* LegacyFindTranslator(std::vector<TranslatorPtr>* list,
+                                 const std::string& name) {
+  list->push_back(MathTranslator());
+  list->push_back(SequenceTranslator());
+  list->push_back(TreeTranslator());
+  list->push_back(TableTranslator());
+  list->push_back(GrammarTranslator());
+  list->push_back(FrameTranslator());
+  list->push_back(GraphDAGTranslator());
+  list->push_back(GraphPlanarTranslator());
+  list->push_back(FlowchartTranslator());
+  for (auto& it : *list) {
+    if (it && it->Identifier() == name)
+      return it.get();
+  }
+  return nullptr;
+}
+
+// What a `diagon Math -- 1` process does, beside reading its input.
+void BenchmarkStartup() {
+  std::printf("Startup (diagon Math -- 1):\n");
+  Report("before (construct all)", 1, Run([] {
+           std::vector<TranslatorPtr> list;
+           LegacyFindTranslator(&list, "Math")->Translate("1", "");
+         }));
+  Report("after (MakeTranslator)", 1,
+         Run([] { MakeTranslator("Math")->Translate("1", ""); }));
+}
+
+// The same input drawn in several styles, the way the website shows it.
+void BenchmarkTranslateMany() {
+  std::printf("TranslateMany (3 styles):\n");
+  auto TranslateEach = [](const TranslatorPtr& translator,
+                          const std::string& input,
+                          const std::vector<std::string>& options) {
+    for (const std::string& it : options)
+      translator->Translate(input, it);
+  };
+
+  auto table = MakeTranslator("Table");
+  std::string csv;
+  for (int i = 0; i < 1000; ++i)
+    csv += "Javascript,CSS,HTML,C++,Web,Assembly\n";
+  std::vector<std::string> table_options = {
+      "style\nunicode",
+      "style\nascii",
+      "style\nunicode double",
+  };
+  Report("before (Table, Translate)", csv.size(),
+         Run([&] { TranslateEach(table, csv, table_options); }));
+  Report("after (Table, TranslateMany)", csv.size(),
+         Run([&] { table->TranslateMany(csv, table_options); }));
+
+  auto math = MakeTranslator("Math");
+  std::string equation = "psi = 1 + 1/(1+1/(1+1/(1+1/(1+...))))";
+  std::vector<std::string> math_options = {
+      "style\nUnicode",
+      "style\nASCII",
+      "style\nLatex",
+  };
+  Report("before (Math, Translate)", equation.size(),
+         Run([&] { TranslateEach(math, equation, math_options); }));
+  Report("after (Math, TranslateMany)", equation.size(),
+         Run([&] { math->TranslateMany(equation, math_options); }));
+}
+
+}  // namespace
+
+int main(int, const char**) {
+  BenchmarkToString();
+  BenchmarkToWString();
+  BenchmarkASCIIfy();
+  BenchmarkCompact();
+  BenchmarkSparse();
+  BenchmarkDiff();
+  BenchmarkStartup();
+  BenchmarkTranslateMany();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+// Run the input/output tests and the Grammar examples from several threads at
+// once, sharing the translators and a TranslationCache. Build it with
+// DIAGON_TSAN to check for data races.
+
+#include "filesystem.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "environment.h"
+#include "translator/Factory.h"
+#include "translator/TranslationCache.h"
+
+namespace {
+
+constexpr int kThreads = 8;
+constexpr int kIterations = 4;
+
+struct Test {
+  std::string path;
+  Translator* translator;
+  std::string options;
+  std::string input;
+  std::string output;
+};
+
+std::string ReadFile(std::filesystem::path path) {
+  std::ifstream file(path);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+// Same as in input_output_test.cpp.
+void ParseDirectoryName(std::string name,
+                        std::string* translator_name,
+                        std::string* options) {
+  std::vector<std::string> parts;
+  int left = 0;
+  int right = 0;
+  while (right < name.size()) {
+    if (name[right] == '_' || name[right] == '=') {
+      parts.push_back(name.substr(left, right - left));
+      left = right + 1;
+    }
+    ++right;
+  }
+  parts.push_back(name.substr(left, right - left));
+
+  *translator_name = parts[0];
+  for (int i = 1; i < parts.size(); ++i) {
+    *options += parts[i] + "\n";
+  }
+}
+
+}  // namespace
+
+int main(int, const char**) {
+  std::vector<Test> tests;
+  for (auto& dir : std::filesystem::directory_iterator(test_directory)) {
+    std::string translator_name;
+    std::string options;
+    ParseDirectoryName(dir.path().filename(), &translator_name, &options);
+    Translator* translator = FindTranslator(translator_name);
+    if (!translator)
+      continue;
+
+    for (auto& test : std::filesystem::directory_iterator(dir.path())) {
+      if (!std::filesystem::exists(test.path() / "output"))
+        continue;
+      tests.push_back({
+          test.path().string(),
+          translator,
+          options,
+          ReadFile(test.path() / "input"),
+          ReadFile(test.path() / "output"),
+      });
+    }
+  }
+
+  // Grammar has no input/output tests. Its examples are compared to their
+  // translation on a single thread instead.
+  if (Translator* grammar = FindTranslator("Grammar")) {
+    for (const auto& example : grammar->Examples()) {
+      tests.push_back({
+          "Grammar: " + example.title,
+          grammar,
+          "",
+          example.input,
+          grammar->Translate(example.input, ""),
+      });
+    }
+  }
+
+  // Small enough for some entries to be evicted.
+  TranslationCache cache(16 << 10);
+
+  // Every thread runs every test, starting at a different one, so that the
+  // same translators are used concurrently. Every other iteration goes through
+  // the cache.
+  std::atomic<int> failures{0};
+  auto work = [&](int thread) {
+    const int offset = thread * int(tests.size()) / kThreads;
+    for (int iteration = 0; iteration < kIterations; ++iteration) {
+      // Written to stdout while the other threads translate. It must not end
+      // up in their output.
+      std::printf("thread %d: iteration %d\n", thread, iteration);
+      for (size_t i = 0; i < tests.size(); ++i) {
+        const Test& test = tests[(i + offset) % tests.size()];
+        std::string output =
+            iteration % 2
+                ? cache.Translate(test.translator, test.input, test.options)
+                : test.translator->Translate(test.input, test.options);
+        if (output != test.output) {
+          std::cout << "  [FAIL] " << test.path << std::endl;
+          failures++;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i)
+    threads.emplace_back(work, i);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  TranslationCacheStats stats = cache.stats();
+  std::cout << tests.size() << " tests, " << kThreads << " threads, "
+            << failures << " failures." << std::endl;
+  std::cout << "cache: " << stats.hits << " hits, " << stats.misses
+            << " misses, " << stats.evictions << " evictions." << std::endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
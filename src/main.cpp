@@ -2,37 +2,106 @@
 // Use of this source code is governed by the MIT license that can be found in
 // the LICENSE file.
 
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 #include "api.hpp"
 #include "environment.h"
+#include "screen/Sink.h"
+#include "translator/DiskCache.h"
 #include "translator/Factory.h"
+#include "translator/Translator.h"
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 
+// The diagnostics of the last |translate| or |translate_edited| call, one per
+// line.
+static std::string last_diagnostics;
+
+static void SetLastDiagnostics(const std::vector<Diagnostic>& diagnostics) {
+  last_diagnostics.clear();
+  for (const Diagnostic& diagnostic : diagnostics)
+    last_diagnostics += ToString(diagnostic) + "\n";
+}
+
 EMSCRIPTEN_KEEPALIVE
 extern "C" const char* translate(const char* translator_name,
                                  const char* input,
                                  const char* options) {
+  last_diagnostics.clear();
   auto* translator = FindTranslator(translator_name);
-  if (!translator)
+  if (!translator) {
     std::cerr << "Translator not found" << std::endl;
+    return "";
+  }
 
   static std::string out;
+  std::vector<Diagnostic> diagnostics;
   try {
+    ScopedDiagnostics scoped_diagnostics(&diagnostics);
     out = translator->Translate(input, options);
   } catch (...) {
     std::cerr << "Error" << std::endl;
   }
+  SetLastDiagnostics(diagnostics);
   return out.c_str();
 }
 
+// Same as |translate|, for an input edited since the previous call, e.g. on
+// every keystroke. What the edit didn't damage is reused.
+EMSCRIPTEN_KEEPALIVE
+extern "C" const char* translate_edited(const char* translator_name,
+                                        const char* input,
+                                        const char* options) {
+  last_diagnostics.clear();
+  auto* translator = FindTranslator(translator_name);
+  if (!translator) {
+    std::cerr << "Translator not found" << std::endl;
+    return "";
+  }
+
+  // A new session is opened when the translator or the options change.
+  static std::string session_key;
+  static std::unique_ptr<TranslationSession> session;
+  static std::string out;
+  std::vector<Diagnostic> diagnostics;
+  try {
+    ScopedDiagnostics scoped_diagnostics(&diagnostics);
+    std::string key = std::string(translator_name) + '\n' + options;
+    if (session && key == session_key) {
+      session->SetInput(input);
+    } else {
+      session = translator->OpenSession(input,
+                                        translator->CompileOptions(options));
+      session_key = std::move(key);
+    }
+    out = session->Render();
+  } catch (...) {
+    session.reset();
+    std::cerr << "Error" << std::endl;
+  }
+  SetLastDiagnostics(diagnostics);
+  return out.c_str();
+}
+
+// The problems found in the input by the last |translate| or
+// |translate_edited| call, one per line.
+EMSCRIPTEN_KEEPALIVE
+extern "C" const char* diagnostics() {
+  return last_diagnostics.c_str();
+}
+
 EMSCRIPTEN_KEEPALIVE
 extern "C" const char* highlight(const char* translator_name,
                                  const char* input) {
   auto* translator = FindTranslator(translator_name);
-  if (!translator)
+  if (!translator) {
     std::cerr << "Translator not found" << std::endl;
+    return "";
+  }
 
   static std::string out;
   try {
@@ -80,6 +149,11 @@ OPTIONS:
   -h, --help:    Print this page.
   -v, --version: Print the version.
   -l, --list:    List the available translators.
+  --cache-dir=<directory>:
+                 Reuse the outputs of previous identical invocations, stored
+                 in <directory>.
+  --cache-size=<megabytes>:
+                 The size the cache directory is trimmed to. Default: 256.
 
 TRANSLATOR:
 )description";
@@ -98,7 +172,7 @@ TRANSLATOR-OPTIONS:
   -- <input>   : Read the input from the command line. Without this option, it
                  is read from the standard input.
 
-  -option=value: Provide a translator specific option.
+  --option=value: Provide a translator specific option.
 
 COOKBOOK:
   Reading from:
@@ -107,9 +181,9 @@ COOKBOOK:
     * stdin       : diagon Math
 
   Providing options:
-    diagon Math -style=Unicode -- 1 + 1/2
-    diagon Math -style=Ascii   -- 1 + 1/2
-    diagon Math -style=Latex   -- 1 + 1/2
+    diagon Math --style=Unicode -- 1 + 1/2
+    diagon Math --style=ASCII   -- 1 + 1/2
+    diagon Math --style=Latex   -- 1 + 1/2
   
 WEBSITE:
   This tool can also be used as a WebAssembly application on the website:
@@ -128,6 +202,13 @@ int PrintVersion() {
   return EXIT_SUCCESS;
 }
 
+// The diagnostics are written once the output is, so that they don't
+// interleave with it.
+void PrintDiagnostics(const std::vector<Diagnostic>& diagnostics) {
+  for (const Diagnostic& diagnostic : diagnostics)
+    std::cerr << ToString(diagnostic) << std::endl;
+}
+
 int PrintError(std::string error) {
   std::cout << error << std::endl;
   return EXIT_FAILURE;
@@ -174,6 +255,10 @@ int PrintTranslatorHelp(Translator* translator) {
     int i = 0;
     for (auto& it : translator->Options()) {
       std::cout << "   " << (++i) << ") " << it.description << std::endl;
+      if (it.values.empty()) {
+        std::cout << "     --" << it.name << "=" << it.default_value
+                  << " (default)" << std::endl;
+      }
       for (auto& value : it.values) {
         if (value == it.default_value)
           std::cout << "     --" << it.name << "=" << value << " (default)"
@@ -199,9 +284,33 @@ int PrintTranslatorHelp(Translator* translator) {
   return EXIT_SUCCESS;
 }
 
-int Translate(Translator* translator,
+int PrintTranslatorNotFound(const std::string& translator) {
+  std::cout << "The translator: " << translator << " doesn't exist"
+            << std::endl;
+  std::cout << "List of available translator:" << std::endl;
+  for (auto& translator : TranslatorList())
+    std::cout << std::string("  - ") + translator->Identifier() << std::endl;
+
+  std::cout << "Please read the manual by using diagon --help" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+struct CacheOptions {
+  std::string directory;  // Empty when caching is disabled.
+  uintmax_t max_bytes = uintmax_t(256) << 20;
+};
+
+int Translate(const std::string& translator_name,
+              const CacheOptions& cache_options,
               int argument_count,
               const char** arguments) {
+  // Constructed only when needed, so that cached invocations don't pay for it.
+  // It is missing when diagon was built without it.
+  auto translator = [&] { return FindTranslator(translator_name); };
+  auto translator_not_found = [&] {
+    return PrintTranslatorNotFound(translator_name);
+  };
+
   // Read the options
   auto next_argument = [&]() {
     argument_count--;
@@ -233,11 +342,15 @@ int Translate(Translator* translator,
   while (argument_count) {
     std::string argument = next_argument();
 
-    if (argument == "--help")
-      return PrintTranslatorHelp(translator);
+    if (argument == "--help") {
+      return translator() ? PrintTranslatorHelp(translator())
+                          : translator_not_found();
+    }
 
-    if (argument == "--examples")
-      return PrintTranslatorExamples(translator);
+    if (argument == "--examples") {
+      return translator() ? PrintTranslatorExamples(translator())
+                          : translator_not_found();
+    }
 
     if (argument == "--") {
       input = read_remaining_args();
@@ -273,19 +386,48 @@ int Translate(Translator* translator,
     input = read_stdin();
   }
 
-  std::string output = translator->Translate(input, option_list);
-  std::cout << output << std::endl;
-  return EXIT_SUCCESS;
-}
+  if (!cache_options.directory.empty()) {
+    // The options are hashed as written: normalizing them would require the
+    // translator.
+    DiskCache cache(cache_options.directory, cache_options.max_bytes);
+    ContentHash hash =
+        HashContent({git_version, translator_name, option_list, input});
+    std::string output;
+    if (cache.Get(hash, &output)) {
+      std::cout << output << std::endl;
+      return EXIT_SUCCESS;
+    }
 
-int PrintTranslatorNotFound(const std::string& translator) {
-  std::cout << "The translator: " << translator << " doesn't exist"
-            << std::endl;
-  std::cout << "List of available translator:" << std::endl;
-  for (auto& translator : TranslatorList())
-    std::cout << std::string("  - ") + translator->Identifier() << std::endl;
+    if (!translator())
+      return translator_not_found();
+    OptionSet options = translator()->CompileOptions(option_list);
+    if (!options.ok())
+      return PrintError(options.errors().front());
+
+    TranslationResult result =
+        translator()->TranslateWithDiagnostics(input, options);
+    std::cout << result.output << std::endl;
+    PrintDiagnostics(result.diagnostics);
+    // Only the output is stored: a cache hit would lose the diagnostics.
+    if (result.diagnostics.empty())
+      cache.Put(hash, result.output);
+    return EXIT_SUCCESS;
+  }
 
-  std::cout << "Please read the manual by using diagon --help" << std::endl;
+  if (!translator())
+    return translator_not_found();
+  OptionSet options = translator()->CompileOptions(option_list);
+  if (!options.ok())
+    return PrintError(options.errors().front());
+
+  // Stream the output, instead of holding a copy of it.
+  std::vector<Diagnostic> diagnostics;
+  {
+    ScopedDiagnostics scoped_diagnostics(&diagnostics);
+    translator()->TranslateTo(input, options, StreamSink(std::cout).get());
+  }
+  std::cout << std::endl;
+  PrintDiagnostics(diagnostics);
   return EXIT_SUCCESS;
 }
 
@@ -297,6 +439,26 @@ int PrintAPI() {
 }  // namespace
 
 int main(int argument_count, const char** arguments) {
+  // Options placed before the translator.
+  CacheOptions cache_options;
+  while (argument_count > 1) {
+    std::string argument = arguments[1];
+    if (argument.rfind("--cache-dir=", 0) == 0) {
+      cache_options.directory = argument.substr(12);
+    } else if (argument.rfind("--cache-size=", 0) == 0) {
+      std::string value = argument.substr(13);
+      char* end = nullptr;
+      uintmax_t megabytes = std::strtoull(value.c_str(), &end, 10);
+      if (value.empty() || *end)
+        return PrintError("Invalid cache size: " + value);
+      cache_options.max_bytes = megabytes << 20;
+    } else {
+      break;
+    }
+    argument_count--;
+    arguments++;
+  }
+
   if (argument_count <= 1)
     return PrintHelp();
   std::string argument_1 = arguments[1];
@@ -319,10 +481,9 @@ int main(int argument_count, const char** arguments) {
   }
 
   std::string translator_name = arguments[1];
-  auto* translator = FindTranslator(translator_name);
-
-  if (translator)
-    return Translate(std::move(translator), argument_count - 2, arguments + 2);
+  if (!HasTranslator(translator_name))
+    return PrintTranslatorNotFound(translator_name);
 
-  return PrintTranslatorNotFound(translator_name);
+  return Translate(translator_name, cache_options, argument_count - 2,
+                   arguments + 2);
 }
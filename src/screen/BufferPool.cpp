@@ -0,0 +1,10 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/BufferPool.h"
+
+BufferPoolStats& ThreadBufferPoolStats() {
+  thread_local BufferPoolStats stats;
+  return stats;
+}
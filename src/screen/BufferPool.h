@@ -0,0 +1,171 @@
+#ifndef SCREEN_BUFFER_POOL_H
+#define SCREEN_BUFFER_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Counters of the buffer pools of a thread.
+struct BufferPoolStats {
+  // |Take| calls reusing a pooled buffer, and the ones allocating a new one.
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // Bytes held by the pooled buffers, waiting to be reused.
+  size_t retained_bytes = 0;
+
+  double HitRate() const {
+    return hits + misses ? double(hits) / double(hits + misses) : 0.0;
+  }
+};
+
+// The counters of the buffer pools of the calling thread.
+BufferPoolStats& ThreadBufferPoolStats();
+
+// A thread-local pool of |Buffer| (a std::vector or a std::basic_string), so
+// that the buffers of a translation are reused by the next one instead of
+// being freed and allocated again.
+//
+// The pool keeps at most |kMaxBuffers| buffers. Buffers much larger than the
+// recent requests are freed, so that a single huge translation doesn't pin
+// its memory forever.
+template <typename Buffer>
+class BufferPool {
+ public:
+  // An empty buffer, with room for at least |size| elements.
+  static Buffer Take(size_t size) {
+    if (BufferPool* pool = Get())
+      return pool->TakeBuffer(size);
+    Buffer buffer;
+    buffer.reserve(size);
+    return buffer;
+  }
+
+  // Give |buffer| back, for a later |Take|.
+  static void Return(Buffer&& buffer) {
+    if (BufferPool* pool = Get())
+      pool->ReturnBuffer(std::move(buffer));
+  }
+
+  ~BufferPool() {
+    Clear();
+    destroyed_ = true;
+  }
+
+ private:
+  static constexpr size_t kMaxBuffers = 8;
+  // The high-water mark is the largest request of the last |kWindow| ones.
+  static constexpr int kWindow = 64;
+
+  // Null while the thread exits, once the pool was destroyed.
+  static BufferPool* Get() {
+    if (destroyed_)
+      return nullptr;
+    thread_local BufferPool pool;
+    return &pool;
+  }
+
+  static size_t Bytes(const Buffer& buffer) {
+    return buffer.capacity() * sizeof(typename Buffer::value_type);
+  }
+
+  Buffer TakeBuffer(size_t size) {
+    window_max_ = std::max(window_max_, size);
+    high_water_ = std::max(high_water_, size);
+    if (++window_count_ == kWindow) {
+      high_water_ = window_max_;
+      window_max_ = 0;
+      window_count_ = 0;
+      Trim();
+    }
+
+    // Best fit.
+    auto best = buffers_.end();
+    for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+      if (it->capacity() >= size &&
+          (best == buffers_.end() || it->capacity() < best->capacity())) {
+        best = it;
+      }
+    }
+
+    BufferPoolStats& stats = ThreadBufferPoolStats();
+    if (best == buffers_.end()) {
+      stats.misses++;
+      Buffer buffer;
+      buffer.reserve(size);
+      return buffer;
+    }
+
+    stats.hits++;
+    stats.retained_bytes -= Bytes(*best);
+    std::swap(*best, buffers_.back());
+    Buffer buffer = std::move(buffers_.back());
+    buffers_.pop_back();
+    buffer.clear();
+    return buffer;
+  }
+
+  void ReturnBuffer(Buffer&& buffer) {
+    if (buffer.capacity() == 0 || buffers_.size() >= kMaxBuffers ||
+        IsOversized(buffer)) {
+      return;
+    }
+    ThreadBufferPoolStats().retained_bytes += Bytes(buffer);
+    buffers_.push_back(std::move(buffer));
+  }
+
+  bool IsOversized(const Buffer& buffer) const {
+    return buffer.capacity() > 2 * std::max(high_water_, size_t(1024));
+  }
+
+  // Free the buffers no longer fitting the high-water mark.
+  void Trim() {
+    for (size_t i = 0; i < buffers_.size();) {
+      if (IsOversized(buffers_[i])) {
+        ThreadBufferPoolStats().retained_bytes -= Bytes(buffers_[i]);
+        std::swap(buffers_[i], buffers_.back());
+        buffers_.pop_back();
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  void Clear() {
+    for (const Buffer& buffer : buffers_)
+      ThreadBufferPoolStats().retained_bytes -= Bytes(buffer);
+    buffers_.clear();
+  }
+
+  static thread_local bool destroyed_;
+
+  std::vector<Buffer> buffers_;
+  size_t high_water_ = 0;
+  size_t window_max_ = 0;
+  int window_count_ = 0;
+};
+
+template <typename Buffer>
+thread_local bool BufferPool<Buffer>::destroyed_ = false;
+
+// A buffer taken from the pool of the calling thread, and given back when
+// destroyed.
+template <typename Buffer>
+class PooledBuffer {
+ public:
+  explicit PooledBuffer(size_t size = 0)
+      : buffer_(BufferPool<Buffer>::Take(size)) {}
+  ~PooledBuffer() { BufferPool<Buffer>::Return(std::move(buffer_)); }
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+  Buffer* get() { return &buffer_; }
+  Buffer& operator*() { return buffer_; }
+  Buffer* operator->() { return &buffer_; }
+
+ private:
+  Buffer buffer_;
+};
+
+#endif /* end of include guard: SCREEN_BUFFER_POOL_H */
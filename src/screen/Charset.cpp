@@ -0,0 +1,125 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/Charset.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIAGON_CHARSET_SSE2
+#endif
+
+namespace {
+
+// Number of cells tested at once by the fast path.
+constexpr ptrdiff_t kBlock = 16;
+
+// Returns whether one of the |kBlock| cells starting at |cells| is in
+// [first, first + size).
+bool AnyInRange(const wchar_t* cells, uint32_t first, uint32_t size) {
+#if defined(DIAGON_CHARSET_SSE2)
+  // SSE2 only has signed comparisons. Offsetting both sides by the sign bit
+  // turns them into unsigned ones.
+  auto load = [&](int i) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells) + i);
+  };
+  if constexpr (sizeof(wchar_t) == 4) {
+    __m128i bias = _mm_set1_epi32(int32_t(first + 0x80000000u));
+    __m128i limit = _mm_set1_epi32(int32_t(size ^ 0x80000000u));
+    __m128i any = _mm_setzero_si128();
+    for (int i = 0; i < 4; ++i) {
+      __m128i offset = _mm_sub_epi32(load(i), bias);
+      any = _mm_or_si128(any, _mm_cmplt_epi32(offset, limit));
+    }
+    return _mm_movemask_epi8(any);
+  } else {
+    __m128i bias = _mm_set1_epi16(int16_t(first + 0x8000u));
+    __m128i limit = _mm_set1_epi16(int16_t(size ^ 0x8000u));
+    __m128i a = _mm_cmplt_epi16(_mm_sub_epi16(load(0), bias), limit);
+    __m128i b = _mm_cmplt_epi16(_mm_sub_epi16(load(1), bias), limit);
+    return _mm_movemask_epi8(_mm_or_si128(a, b));
+  }
+#else
+  // Branchless reduction, so that the compiler can vectorize it.
+  bool any = false;
+  for (ptrdiff_t i = 0; i < kBlock; ++i)
+    any |= uint32_t(cells[i]) - first < size;
+  return any;
+#endif
+}
+
+// clang-format off
+std::deque<Charset>& Charsets() {
+  static std::deque<Charset> charsets = {
+    {
+      {L'─', L'-'}, {L'│', L'|'},
+      {L'┐', L'.'}, {L'┘', L'\''}, {L'┌', L'.'}, {L'└', L'\''},
+      {L'┬', L'-'}, {L'┴', L'-'}, {L'├', L'-'}, {L'┤', L'-'},
+      {L'△', L'^'}, {L'▽', L'V'},
+    },
+    {
+      {L'─', L'-'}, {L'│', L'|'},
+      {L'┐', L'.'}, {L'┘', L'\''}, {L'┌', L'.'}, {L'└', L'\''},
+      {L'┬', L'.'}, {L'┴', L'\''}, {L'├', L'-'}, {L'┤', L'-'},
+      {L'△', L'^'}, {L'▽', L'V'},
+    },
+  };
+  return charsets;
+}
+// clang-format on
+
+}  // namespace
+
+Charset::Charset(std::initializer_list<Replacement> replacements) {
+  if (replacements.size() == 0)
+    return;
+
+  auto [min, max] = std::minmax_element(
+      replacements.begin(), replacements.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; });
+  first_ = min->first;
+  table_.resize(max->first - min->first + 1, 0);
+  for (const auto& [from, to] : replacements)
+    table_[from - first_] = to;
+}
+
+void Charset::Apply(wchar_t* begin, wchar_t* end) const {
+  const uint32_t first = uint32_t(first_);
+  const uint32_t size = uint32_t(table_.size());
+  const wchar_t* table = table_.data();
+  auto replace = [&](wchar_t& c) {
+    uint32_t index = uint32_t(c) - first;
+    wchar_t replacement = index < size ? table[index] : 0;
+    c = replacement ? replacement : c;
+  };
+
+  // Most cells are blank or text. Skip blocks without any mapped character.
+  while (end - begin >= kBlock) {
+    if (AnyInRange(begin, first, size)) {
+      for (ptrdiff_t i = 0; i < kBlock; ++i)
+        replace(begin[i]);
+    }
+    begin += kBlock;
+  }
+  for (; begin != end; ++begin)
+    replace(*begin);
+}
+
+const Charset* GetCharset(int style) {
+  auto& charsets = Charsets();
+  if (style < 0 || style >= int(charsets.size()))
+    return nullptr;
+  return &charsets[style];
+}
+
+int RegisterCharset(Charset charset) {
+  auto& charsets = Charsets();
+  charsets.push_back(std::move(charset));
+  return int(charsets.size()) - 1;
+}
@@ -0,0 +1,33 @@
+#ifndef SCREEN_CHARSET_H
+#define SCREEN_CHARSET_H
+
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// A set of character replacements, e.g. from box drawing characters to ASCII.
+// It is stored as a table indexed by code point, so that applying it costs the
+// same whatever the number of replacements.
+class Charset {
+ public:
+  using Replacement = std::pair<wchar_t, wchar_t>;
+  Charset(std::initializer_list<Replacement> replacements);
+
+  // Replace the characters in [begin, end).
+  void Apply(wchar_t* begin, wchar_t* end) const;
+
+ private:
+  // The replacement of |first_ + i| is |table_[i]|, or nothing when 0.
+  wchar_t first_ = 0;
+  std::vector<wchar_t> table_;
+};
+
+// Charsets usable from Screen::ASCIIfy(int style), indexed by |style|.
+//  0: Box drawing characters to ASCII.
+//  1: Same as 0, keeping the shape of horizontal T junctions.
+const Charset* GetCharset(int style);
+
+// Add a charset, and returns its style.
+int RegisterCharset(Charset charset);
+
+#endif /* end of include guard: SCREEN_CHARSET_H */
@@ -0,0 +1,47 @@
+#ifndef SCREEN_CONNECTION_H
+#define SCREEN_CONNECTION_H
+
+#include <array>
+
+// Light box drawing characters, described by the set of directions their lines
+// leave the cell. Junctions are merged by OR-ing masks, and resolved to a glyph
+// through compile-time tables.
+enum Connection {
+  kUp = 1 << 0,
+  kDown = 1 << 1,
+  kLeft = 1 << 2,
+  kRight = 1 << 3,
+};
+
+// Lines going in a single direction are drawn full cell.
+// clang-format off
+inline constexpr wchar_t kConnectionGlyph[16] = {
+  L' ', L'│', L'│', L'│',  //        , U   , D   , UD
+  L'─', L'┘', L'┐', L'┤',  // L      , UL  , DL  , UDL
+  L'─', L'└', L'┌', L'├',  // R      , UR  , DR  , UDR
+  L'─', L'┴', L'┬', L'┼',  // LR     , ULR , DLR , UDLR
+};
+// clang-format on
+
+// Reverse of |kConnectionGlyph|, over the box drawing block U+2500-U+257F.
+constexpr std::array<unsigned char, 128> MakeConnectionMasks() {
+  std::array<unsigned char, 128> masks = {};
+  // The full lines come last, so that they win over the single directions.
+  for (int mask = 1; mask < 16; ++mask)
+    masks[kConnectionGlyph[mask] - 0x2500] = mask;
+  return masks;
+}
+inline constexpr std::array<unsigned char, 128> kConnectionMask =
+    MakeConnectionMasks();
+
+constexpr wchar_t ConnectionGlyph(int mask) {
+  return kConnectionGlyph[mask];
+}
+
+// Returns 0 for characters not in |kConnectionGlyph|.
+constexpr int ConnectionMask(wchar_t glyph) {
+  return (glyph >= 0x2500 && glyph < 0x2580) ? kConnectionMask[glyph - 0x2500]
+                                             : 0;
+}
+
+#endif /* end of include guard: SCREEN_CONNECTION_H */
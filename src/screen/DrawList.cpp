@@ -0,0 +1,109 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/DrawList.h"
+
+#include <algorithm>
+
+#include "screen/Screen.h"
+
+void DrawList::DrawText(int x, int y, std::wstring_view text) {
+  if (text.empty())
+    return;
+  spans_.push_back({x, y, int(text.size()), 0, uint32_t(text_.size())});
+  text_ += text;
+  AddRow(y);
+}
+
+void DrawList::FillSpan(int x, int y, int size, wchar_t c) {
+  if (size <= 0)
+    return;
+  spans_.push_back({x, y, size, c, kNoText});
+  AddRow(y);
+}
+
+void DrawList::AddRow(int y) {
+  is_sorted_ = false;
+  if (spans_.size() == 1) {
+    top_ = y;
+    bottom_ = y;
+  }
+  top_ = std::min(top_, y);
+  bottom_ = std::max(bottom_, y);
+}
+
+void DrawList::FillRect(int x, int y, int width, int height, wchar_t c) {
+  for (int yy = y; yy < y + height; ++yy)
+    FillSpan(x, yy, width, c);
+}
+
+void DrawList::DrawBox(int x, int y, int w, int h) {
+  DrawPixel(x + w - 1, y, L'┐');
+  DrawPixel(x + w - 1, y + h - 1, L'┘');
+  DrawPixel(x, y, L'┌');
+  DrawPixel(x, y + h - 1, L'└');
+  FillSpan(x + 1, y, w - 2, L'─');
+  FillSpan(x + 1, y + h - 1, w - 2, L'─');
+  for (int yy = 1; yy < h - 1; ++yy) {
+    DrawPixel(x, y + yy, L'│');
+    DrawPixel(x + w - 1, y + yy, L'│');
+  }
+}
+
+void DrawList::DrawHorizontalLine(int left, int right, int y, wchar_t c) {
+  FillSpan(left, y, right - left + 1, c);
+}
+
+void DrawList::DrawVerticalLine(int top, int bottom, int x, wchar_t c) {
+  for (int y = top; y <= bottom; ++y)
+    DrawPixel(x, y, c);
+}
+
+void DrawList::Sort() {
+  if (is_sorted_)
+    return;
+  is_sorted_ = true;
+  sorted_.clear();
+  if (spans_.empty())
+    return;
+
+  // Counting sort of the spans by row. It is stable, so that the spans of a
+  // row keep their order.
+  const int rows = bottom_ - top_ + 1;
+  offsets_.assign(rows + 1, 0);
+  for (const Span& span : spans_)
+    offsets_[span.y - top_ + 1]++;
+  for (int y = 0; y < rows; ++y)
+    offsets_[y + 1] += offsets_[y];
+  sorted_.resize(spans_.size());
+  for (const Span& span : spans_)
+    sorted_[offsets_[span.y - top_]++] = span;
+}
+
+bool DrawList::ReplayRows(Screen* screen, int top, int bottom) const {
+  const int first = std::max(top, top_);
+  const int last = std::min(bottom, bottom_ + 1);
+  if (sorted_.empty() || first >= last)
+    return false;
+
+  size_t begin = first == top_ ? 0 : offsets_[first - top_ - 1];
+  size_t end = offsets_[last - top_ - 1];
+  std::wstring_view text = text_;
+  for (size_t i = begin; i < end; ++i) {
+    const Span& span = sorted_[i];
+    if (span.text == kNoText)
+      screen->FillSpan(span.x, span.y - top, span.size, span.c);
+    else
+      screen->DrawText(span.x, span.y - top, text.substr(span.text, span.size));
+  }
+  return begin != end;
+}
+
+void DrawList::Replay(Screen* screen) {
+  Sort();
+  ReplayRows(screen, 0, bottom_ + 1);
+  spans_.clear();
+  text_.clear();
+  sorted_.clear();
+}
@@ -0,0 +1,63 @@
+#ifndef SCREEN_DRAW_LIST_H
+#define SCREEN_DRAW_LIST_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Screen;
+
+// Records draw commands, to replay them into a |Screen| in a single pass over
+// its rows. The drawing functions match the |Screen| ones. Every command is
+// split into spans of a single row. The spans of a row are replayed in the
+// order they were recorded, so the result is the same as drawing directly.
+class DrawList {
+ public:
+  void DrawPixel(int x, int y, wchar_t c) { FillSpan(x, y, 1, c); }
+  void DrawText(int x, int y, std::wstring_view text);
+  void DrawBox(int x, int y, int w, int h);
+  void DrawHorizontalLine(int left, int right, int y, wchar_t c = L'─');
+  void DrawVerticalLine(int top, int bottom, int x, wchar_t c = L'│');
+  void FillSpan(int x, int y, int size, wchar_t c);
+  void FillRect(int x, int y, int width, int height, wchar_t c);
+
+  // Draw the recorded commands into |screen|, row by row, and clear them.
+  void Replay(Screen* screen);
+
+  // Sort the recorded commands by row, for |ReplayRows|.
+  void Sort();
+  // Draw the commands of the rows [top, bottom) into |screen|, moved |top|
+  // rows up. The commands must be sorted, and are kept. Returns whether
+  // something was drawn.
+  bool ReplayRows(Screen* screen, int top, int bottom) const;
+
+ private:
+  static constexpr uint32_t kNoText = ~0u;
+
+  // Extend [top_, bottom_] to the row |y| of the last recorded span.
+  void AddRow(int y);
+
+  struct Span {
+    int x;
+    int y;
+    int size;
+    // Either a fill with |c|, or |size| characters of |text_| at |text|.
+    wchar_t c;
+    uint32_t text;
+  };
+
+  std::vector<Span> spans_;
+  std::wstring text_;
+
+  // The spans sorted by row. The spans of the row |top_ + i| end at
+  // |offsets_[i]|, and start where the previous row ends. Reused by |Sort|.
+  std::vector<Span> sorted_;
+  std::vector<size_t> offsets_;
+  bool is_sorted_ = false;
+  // The rows of the recorded spans are within [top_, bottom_].
+  int top_ = 0;
+  int bottom_ = 0;
+};
+
+#endif /* end of include guard: SCREEN_DRAW_LIST_H */
@@ -0,0 +1,82 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/InternedRows.h"
+
+#include <algorithm>
+#include <array>
+
+#include "screen/BufferPool.h"
+#include "screen/Screen.h"
+#include "screen/Sink.h"
+#include "screen/Utf8.h"
+
+InternedRows::InternedRows(const Screen& screen) {
+  // The recent distinct rows, by hash. Repeated rows are usually close to
+  // each other, and a small direct-mapped cache avoids allocating an entry per
+  // distinct row.
+  struct Entry {
+    uint64_t hash;
+    uint32_t index;
+    // The first row equal to the distinct row.
+    int y = -1;
+  };
+  constexpr size_t kEntries = 256;
+  std::array<Entry, kEntries> entries;
+  PooledBuffer<std::wstring> buffer;
+  PooledBuffer<std::wstring> other;
+
+  rows_.reserve(screen.height());
+  for (int y = 0; y < screen.height(); ++y) {
+    std::wstring_view row = screen.RowView(y, buffer.get());
+    uint64_t hash = screen.RowHash(y);
+    Entry& entry = entries[hash % kEntries];
+    if (entry.y >= 0 && entry.hash == hash &&
+        screen.RowView(entry.y, other.get()) == row) {
+      rows_.push_back(entry.index);
+      continue;
+    }
+
+    entry = {hash, uint32_t(unique_count()), y};
+    rows_.push_back(entry.index);
+    size_t offset = data_.size();
+    data_.resize(offset + Utf8Size(row) + 1);
+    *Utf8Encode(row, data_.data() + offset) = '\n';
+    offsets_.push_back(data_.size());
+  }
+}
+
+std::string_view InternedRows::Row(int y) const {
+  size_t begin = offsets_[rows_[y]];
+  size_t end = offsets_[rows_[y] + 1];
+  return std::string_view(data_).substr(begin, end - begin - 1);
+}
+
+void InternedRows::Write(Sink* sink) const {
+  constexpr size_t kBatchSize = 1024;
+  std::vector<std::string_view> parts;
+  parts.reserve(std::min(rows_.size(), kBatchSize));
+  for (uint32_t index : rows_) {
+    parts.emplace_back(data_.data() + offsets_[index],
+                       offsets_[index + 1] - offsets_[index]);
+    if (parts.size() == kBatchSize) {
+      sink->Write(parts.data(), parts.size());
+      parts.clear();
+    }
+  }
+  if (!parts.empty())
+    sink->Write(parts.data(), parts.size());
+}
+
+std::string InternedRows::ToString() const {
+  size_t size = 0;
+  for (uint32_t index : rows_)
+    size += offsets_[index + 1] - offsets_[index];
+
+  std::string out;
+  out.reserve(size);
+  for (uint32_t index : rows_)
+    out.append(data_, offsets_[index], offsets_[index + 1] - offsets_[index]);
+  return out;
+}
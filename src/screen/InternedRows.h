@@ -0,0 +1,41 @@
+#ifndef SCREEN_INTERNED_ROWS_H
+#define SCREEN_INTERNED_ROWS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Screen;
+class Sink;
+
+// The rows of a finished |Screen|, encoded as UTF-8. Identical rows are found
+// through |Screen::RowHash|, and are encoded and stored only once. Diagrams
+// repeating the same rows, like table separators, frame bodies or sequence
+// lifelines, are then cheaper to hold and to output.
+class InternedRows {
+ public:
+  explicit InternedRows(const Screen& screen);
+
+  int height() const { return int(rows_.size()); }
+  // The number of distinct rows.
+  int unique_count() const { return int(offsets_.size()) - 1; }
+
+  // The |y|-th row, without the trailing newline.
+  std::string_view Row(int y) const;
+
+  // Same as |Screen::Write| and |Screen::ToString|. The rows are written
+  // without being copied.
+  void Write(Sink* sink) const;
+  std::string ToString() const;
+
+ private:
+  // The distinct rows, each followed by a newline. The |i|-th one spans
+  // [offsets_[i], offsets_[i + 1]) in |data_|.
+  std::string data_;
+  std::vector<size_t> offsets_ = {0};
+  // The index of the distinct row of every row.
+  std::vector<uint32_t> rows_;
+};
+
+#endif /* end of include guard: SCREEN_INTERNED_ROWS_H */
@@ -0,0 +1,200 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/LayeredScreen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "screen/Connection.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIAGON_COMPOSITE_SSE2
+#endif
+
+namespace {
+
+// Bands are small enough to stay in cache, and numerous enough to balance the
+// work between the threads.
+constexpr int kMinBandHeight = 16;
+constexpr int kBandsPerThread = 4;
+
+wchar_t CompositeCell(wchar_t above, wchar_t below) {
+  if (above == L' ')
+    return below;
+  int above_mask = ConnectionMask(above);
+  int below_mask = ConnectionMask(below);
+  if (above_mask && below_mask)
+    return ConnectionGlyph(above_mask | below_mask);
+  return above;
+}
+
+// Composite the |size| cells of |above| over the ones of |below|.
+void CompositeRow(const wchar_t* above, wchar_t* below, int size) {
+  int i = 0;
+#if defined(DIAGON_COMPOSITE_SSE2)
+  // Blank cells keep the cell below, and the others replace it. Blocks where
+  // two box drawing characters meet are merged by the scalar loop.
+  constexpr int kLanes = 16 / sizeof(wchar_t);
+  for (; i + kLanes <= size; i += kLanes) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i));
+    __m128i blank, both_boxes;
+    if constexpr (sizeof(wchar_t) == 4) {
+      const __m128i block = _mm_set1_epi32(~0x7F);
+      const __m128i box = _mm_set1_epi32(0x2500);
+      blank = _mm_cmpeq_epi32(a, _mm_set1_epi32(L' '));
+      both_boxes =
+          _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(a, block), box),
+                        _mm_cmpeq_epi32(_mm_and_si128(b, block), box));
+    } else {
+      const __m128i block = _mm_set1_epi16(short(~0x7F));
+      const __m128i box = _mm_set1_epi16(0x2500);
+      blank = _mm_cmpeq_epi16(a, _mm_set1_epi16(L' '));
+      both_boxes =
+          _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(a, block), box),
+                        _mm_cmpeq_epi16(_mm_and_si128(b, block), box));
+    }
+    if (_mm_movemask_epi8(both_boxes)) {
+      for (int j = i; j < i + kLanes; ++j)
+        below[j] = CompositeCell(above[j], below[j]);
+      continue;
+    }
+    __m128i out =
+        _mm_or_si128(_mm_and_si128(blank, b), _mm_andnot_si128(blank, a));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(below + i), out);
+  }
+#endif
+  for (; i < size; ++i)
+    below[i] = CompositeCell(above[i], below[i]);
+}
+
+}  // namespace
+
+LayeredScreen::LayeredScreen(int width, int height)
+    : width_(width), height_(height) {}
+
+DrawList& LayeredScreen::Layer(int index) {
+  if (index >= int(layers_.size()))
+    layers_.resize(index + 1);
+  return layers_[index];
+}
+
+void LayeredScreen::RenderBand(int top,
+                               int bottom,
+                               Screen* band,
+                               Screen* scratch) const {
+  const int rows = bottom - top;
+  band->FillRect(0, 0, width_, rows, L' ');
+  if (layers_.empty())
+    return;
+  layers_[0].ReplayRows(band, top, bottom);
+
+  // |scratch| is blank between the layers.
+  for (size_t i = 1; i < layers_.size(); ++i) {
+    if (!layers_[i].ReplayRows(scratch, top, bottom))
+      continue;
+    for (int y = 0; y < rows; ++y)
+      CompositeRow(scratch->Row<wchar_t>(y), band->Row<wchar_t>(y), width_);
+    scratch->FillRect(0, 0, width_, rows, L' ');
+  }
+}
+
+void LayeredScreen::CopyBand(Screen& band,
+                             int top,
+                             int bottom,
+                             Screen* screen) {
+  for (int y = top; y < bottom; ++y) {
+    std::wstring_view row(band.Row<wchar_t>(y - top), band.width());
+    size_t left = row.find_first_not_of(L' ');
+    if (left == std::wstring_view::npos)
+      continue;
+    size_t right = row.find_last_not_of(L' ');
+    screen->DrawText(int(left), y, row.substr(left, right - left + 1));
+  }
+}
+
+Screen LayeredScreen::Render(Screen::Storage storage, int threads) {
+  for (DrawList& layer : layers_)
+    layer.Sort();
+
+  Screen screen(width_, height_, storage);
+  if (width_ == 0 || height_ == 0)
+    return screen;
+
+#if defined(__EMSCRIPTEN__)
+  threads = 1;
+#else
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+#endif
+
+  // Bands are made of whole tiles, so that the threads never write to the
+  // same tile of a sparse screen.
+  int band_height = (height_ + threads * kBandsPerThread - 1) /
+                    (threads * kBandsPerThread);
+  band_height = std::max(kMinBandHeight, band_height);
+  band_height = (band_height + Screen::kTileHeight - 1) /
+                Screen::kTileHeight * Screen::kTileHeight;
+  const int band_count = (height_ + band_height - 1) / band_height;
+  threads = std::min(threads, band_count);
+
+  // The rows of wide and sparse screens can be written concurrently. Compact
+  // screens share a palette, they are composited into a wide screen first.
+  Screen wide;
+  Screen* target = &screen;
+  if (threads > 1 && storage == Screen::Storage::Compact) {
+    wide = Screen(width_, height_);
+    target = &wide;
+  }
+
+  std::atomic<int> next_band{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  auto work = [&] {
+    try {
+      Screen band(width_, band_height);
+      Screen scratch(width_, band_height);
+      for (int i = next_band++; i < band_count; i = next_band++) {
+        const int top = i * band_height;
+        const int bottom = std::min(height_, top + band_height);
+        RenderBand(top, bottom, &band, &scratch);
+        CopyBand(band, top, bottom, target);
+      }
+    } catch (...) {
+      // Stop the other threads, and rethrow on the calling thread.
+      next_band = band_count;
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < threads; ++i) {
+    try {
+      workers.emplace_back(work);
+    } catch (const std::system_error&) {
+      // Render with the threads available.
+      break;
+    }
+  }
+  work();
+  for (std::thread& worker : workers)
+    worker.join();
+
+  if (error)
+    std::rethrow_exception(error);
+  if (target != &screen)
+    screen.Append(wide, 0, 0);
+  return screen;
+}
@@ -0,0 +1,53 @@
+#ifndef SCREEN_LAYERED_SCREEN_H
+#define SCREEN_LAYERED_SCREEN_H
+
+#include <deque>
+
+#include "screen/DrawList.h"
+#include "screen/Screen.h"
+
+// A canvas made of layers. Each layer records its own draw commands, and the
+// layers are stacked in index order, regardless of the order they were drawn
+// in:
+// - Blank cells let the layers below show through.
+// - Box drawing lines crossing lines of a lower layer are merged into
+//   junctions. See screen/Connection.h.
+// - Any other character replaces the one below.
+//
+// |Render| splits the canvas into horizontal bands, rasterized and composited
+// one at a time, or in parallel.
+class LayeredScreen {
+ public:
+  LayeredScreen(int width, int height);
+
+  // The |index|-th layer, created empty when needed. References stay valid
+  // when other layers are created.
+  DrawList& Layer(int index);
+
+  // Rasterize and composite the layers. The recorded commands are kept.
+  //
+  // |threads| is the number of threads used, including the calling one, 0 for
+  // one per core. The other threads are started for this call only, and don't
+  // see the thread-local state of the caller, e.g. its translation budget.
+  // Exceptions thrown while rendering are rethrown on the calling thread.
+  Screen Render(Screen::Storage storage = Screen::Storage::Wide,
+                int threads = 1);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+ private:
+  // Rasterize and composite the rows [top, bottom) into |band|, using
+  // |scratch| for the layers above the first one.
+  void RenderBand(int top, int bottom, Screen* band, Screen* scratch) const;
+  // Write the rows of |band| to the rows [top, bottom) of |screen|, which are
+  // blank. Only the non blank part of the rows are written, which keeps
+  // sparse screens sparse.
+  static void CopyBand(Screen& band, int top, int bottom, Screen* screen);
+
+  int width_;
+  int height_;
+  std::deque<DrawList> layers_;
+};
+
+#endif /* end of include guard: SCREEN_LAYERED_SCREEN_H */
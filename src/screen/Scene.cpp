@@ -0,0 +1,215 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/Scene.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "screen/Connection.h"
+#include "screen/DrawList.h"
+#include "screen/LayeredScreen.h"
+
+namespace {
+
+// The direction from |from| to |to|, on the same row or column.
+int Direction(Scene::Point from, Scene::Point to) {
+  if (to.x < from.x)
+    return kLeft;
+  if (to.x > from.x)
+    return kRight;
+  return to.y < from.y ? kUp : kDown;
+}
+
+}  // namespace
+
+Scene::Scene(int width, int height) : width_(width), height_(height) {}
+
+void Scene::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+}
+
+void Scene::Add(Element element) {
+  element.layer = layer_;
+  elements_.push_back(element);
+}
+
+void Scene::FillRect(int x, int y, int width, int height, wchar_t c) {
+  if (width <= 0 || height <= 0)
+    return;
+  Add({Kind::Fill, 0, x, y, width, height, c, 0});
+}
+
+void Scene::DrawText(int x, int y, std::wstring_view text) {
+  if (text.empty())
+    return;
+  Add({Kind::Text, 0, x, y, int(text.size()), 1, 0, uint32_t(text_.size())});
+  text_ += text;
+}
+
+void Scene::DrawBox(int x, int y, int w, int h) {
+  Add({Kind::Box, 0, x, y, w, h, 0, 0});
+}
+
+void Scene::DrawBoxedText(int x, int y, std::wstring_view text) {
+  DrawText(x + 1, y + 1, text);
+  DrawBox(x, y, int(text.size()) + 2, 3);
+}
+
+void Scene::DrawPolyline(const std::vector<Point>& points, Stroke stroke) {
+  if (points.empty())
+    return;
+  Add({Kind::Polyline, 0, 0, 0, int(points.size()), 1, wchar_t(stroke),
+       uint32_t(points_.size())});
+  points_.insert(points_.end(), points.begin(), points.end());
+}
+
+void Scene::DrawVerticalLineComplete(int top, int bottom, int x) {
+  Add({Kind::VerticalLineComplete, 0, x, top, 1, bottom, 0, 0});
+}
+
+void Scene::Connect(int x, int y, int mask) {
+  Add({Kind::Connect, 0, x, y, mask, 1, 0, 0});
+}
+
+void Scene::DrawArrowHead(int x, int y) {
+  Add({Kind::ArrowHead, 0, x, y, 1, 1, 0, 0});
+}
+
+void Scene::Append(const Scene& other, int x, int y) {
+  // Only the part of |other| overlapping the current area can cover
+  // something.
+  const int right = std::min(width_, x + other.width_);
+  const int bottom = std::min(height_, y + other.height_);
+  FillRect(x, y, right - x, bottom - y, L' ');
+
+  Resize(std::max(width_, x + other.width_),  //
+         std::max(height_, y + other.height_));
+
+  const uint32_t text_offset = uint32_t(text_.size());
+  const uint32_t points_offset = uint32_t(points_.size());
+  text_ += other.text_;
+  for (Point point : other.points_)
+    points_.push_back({point.x + x, point.y + y});
+
+  elements_.reserve(elements_.size() + other.elements_.size());
+  for (Element element : other.elements_) {
+    element.layer = layer_;
+    element.x += x;
+    element.y += y;
+    if (element.kind == Kind::Text)
+      element.data += text_offset;
+    if (element.kind == Kind::Polyline)
+      element.data += points_offset;
+    if (element.kind == Kind::VerticalLineComplete)
+      element.height += y;
+    elements_.push_back(element);
+  }
+}
+
+void Scene::Layer(int index) {
+  layer_ = index;
+  layered_ = true;
+}
+
+void Scene::Flatten() {
+  layer_ = -1;
+}
+
+template <typename Canvas>
+void Scene::DrawShape(const Element& element, Canvas* canvas) const {
+  switch (element.kind) {
+    case Kind::Fill:
+      canvas->FillRect(element.x, element.y, element.width, element.height,
+                       element.c);
+      return;
+
+    case Kind::Text:
+      canvas->DrawText(
+          element.x, element.y,
+          std::wstring_view(text_).substr(element.data, element.width));
+      return;
+
+    case Kind::Box:
+      canvas->DrawBox(element.x, element.y, element.width, element.height);
+      return;
+
+    case Kind::Polyline: {
+      const Point* points = points_.data() + element.data;
+      const int size = element.width;
+      const bool solid = Stroke(element.c) == Stroke::Solid;
+
+      for (int i = 0; i + 1 < size; ++i) {
+        Point a = points[i];
+        Point b = points[i + 1];
+        if (a.y == b.y) {
+          canvas->FillRect(std::min(a.x, b.x), a.y, std::abs(b.x - a.x) + 1, 1,
+                           solid ? L'─' : L'-');
+        } else {
+          canvas->FillRect(a.x, std::min(a.y, b.y), 1, std::abs(b.y - a.y) + 1,
+                           solid ? L'│' : L'|');
+        }
+      }
+
+      for (int i = 1; i + 1 < size; ++i) {
+        int mask = Direction(points[i], points[i - 1]) |
+                   Direction(points[i], points[i + 1]);
+        wchar_t corner = solid ? ConnectionGlyph(mask)
+                               : (mask & kDown) ? L'.'
+                                                : L'`';
+        canvas->DrawPixel(points[i].x, points[i].y, corner);
+      }
+      return;
+    }
+
+    default:
+      return;
+  }
+}
+
+void Scene::DrawElement(const Element& element, Screen* screen) const {
+  switch (element.kind) {
+    case Kind::VerticalLineComplete:
+      screen->DrawVerticalLineComplete(element.y, element.height, element.x);
+      return;
+
+    case Kind::Connect:
+      screen->Connect(element.x, element.y, element.width);
+      return;
+
+    case Kind::ArrowHead: {
+      auto pixel = screen->Pixel(element.x, element.y);
+      if (pixel == L'─' || pixel == L'-' || pixel == L'_')
+        pixel = L'▽';
+      else if (pixel == L' ')
+        pixel = L'│';
+      return;
+    }
+
+    default:
+      DrawShape(element, screen);
+      return;
+  }
+}
+
+Screen Scene::Rasterize(Screen::Storage storage, int threads) const {
+  if (!layered_) {
+    Screen screen(width_, height_, storage);
+    for (const Element& element : elements_)
+      DrawElement(element, &screen);
+    return screen;
+  }
+
+  // The layered elements come first.
+  LayeredScreen canvas(width_, height_);
+  auto it = elements_.begin();
+  for (; it != elements_.end() && it->layer >= 0; ++it)
+    DrawShape(*it, &canvas.Layer(it->layer));
+
+  Screen screen = canvas.Render(storage, threads);
+  for (; it != elements_.end(); ++it)
+    DrawElement(*it, &screen);
+  return screen;
+}
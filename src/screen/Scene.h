@@ -0,0 +1,130 @@
+#ifndef SCREEN_SCENE_H
+#define SCREEN_SCENE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "screen/Screen.h"
+
+// A retained drawing: boxes, lines, polylines, text runs and junctions, with
+// integer cell coordinates. A layout records it once, and it is rasterized into
+// a |Screen| as many times as needed, e.g. once per style. The drawing
+// functions match the |Screen| ones.
+//
+// The elements are drawn in the order they were added, so that rasterizing
+// gives the same result as drawing into a |Screen| directly. Elements must fit
+// in the size of the scene when it is rasterized.
+class Scene {
+ public:
+  struct Point {
+    int x = 0;
+    int y = 0;
+  };
+
+  enum class Stroke {
+    // ─ │ with ┌ ┐ └ ┘ corners.
+    Solid,
+    // - | with . ` corners.
+    Dashed,
+  };
+
+  Scene() = default;
+  Scene(int width, int height);
+
+  // Same as |Screen::Resize|. Elements past the new size must not remain.
+  void Resize(int width, int height);
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  void DrawPixel(int x, int y, wchar_t c) { FillRect(x, y, 1, 1, c); }
+  void DrawText(int x, int y, std::wstring_view text);
+  void DrawBox(int x, int y, int w, int h);
+  void DrawBoxedText(int x, int y, std::wstring_view text);
+  void DrawHorizontalLine(int left, int right, int y, wchar_t c = L'─') {
+    FillRect(left, y, right - left + 1, 1, c);
+  }
+  void DrawVerticalLine(int top, int bottom, int x, wchar_t c = L'│') {
+    FillRect(x, top, 1, bottom - top + 1, c);
+  }
+  void FillRect(int x, int y, int width, int height, wchar_t c);
+
+  // Horizontal and vertical segments joining consecutive |points|. The points
+  // where the direction changes get a corner of |stroke|.
+  void DrawPolyline(const std::vector<Point>& points,
+                    Stroke stroke = Stroke::Solid);
+
+  // Same as the |Screen| functions, merging lines into junctions. See
+  // screen/Connection.h.
+  void DrawVerticalLineComplete(int top, int bottom, int x);
+  void Connect(int x, int y, int mask);
+
+  // The tip of a line coming from above, ending on the border at (x, y): ▽ on
+  // horizontal lines, │ on blank cells. Other cells are kept.
+  void DrawArrowHead(int x, int y);
+
+  // Same as |Screen::Append|: |other| is drawn over the area it covers,
+  // including its blank cells. |other| must not use layers.
+  void Append(const Scene& other, int x, int y);
+
+  // The elements added next are drawn in the |index|-th layer. Layers are
+  // stacked in index order and composited like |LayeredScreen| layers, in
+  // parallel bands. Only fills, text, boxes and polylines can be layered.
+  void Layer(int index);
+  // The elements added next are drawn over the composited layers.
+  void Flatten();
+
+  // |threads| is used to composite the layers. See |LayeredScreen::Render|.
+  Screen Rasterize(Screen::Storage storage = Screen::Storage::Wide,
+                   int threads = 1) const;
+
+ private:
+  enum class Kind : uint8_t {
+    Fill,
+    Text,
+    Box,
+    Polyline,
+    VerticalLineComplete,
+    Connect,
+    ArrowHead,
+  };
+
+  // The meaning of the fields depends on |kind|:
+  // - Fill: the rectangle (x, y, width, height), filled with |c|.
+  // - Text: |width| characters of |text_| at |data|.
+  // - Box: the rectangle (x, y, width, height).
+  // - Polyline: |width| points of |points_| at |data|, with the |c| stroke.
+  // - VerticalLineComplete: the column |x|, from |y| to |height|.
+  // - Connect: the |width| mask.
+  // Elements with a negative |layer| are drawn over the composited layers.
+  struct Element {
+    Kind kind;
+    int layer;
+    int x;
+    int y;
+    int width;
+    int height;
+    wchar_t c;
+    uint32_t data;
+  };
+
+  void Add(Element element);
+
+  // Draw the fills, text, boxes and polylines into a |Screen| or a |DrawList|.
+  template <typename Canvas>
+  void DrawShape(const Element& element, Canvas* canvas) const;
+  void DrawElement(const Element& element, Screen* screen) const;
+
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<Element> elements_;
+  std::wstring text_;
+  std::vector<Point> points_;
+
+  // The layer of the elements added next. -1 after |Flatten|.
+  int layer_ = 0;
+  bool layered_ = false;
+};
+
+#endif /* end of include guard: SCREEN_SCENE_H */
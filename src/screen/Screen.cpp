@@ -4,32 +4,142 @@
 
 #include "screen/Screen.h"
 
-#include <codecvt>
-#include <locale>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "screen/BufferPool.h"
+#include "screen/Charset.h"
+#include "screen/Connection.h"
+#include "screen/Sink.h"
+#include "screen/Utf8.h"
 
 std::string to_string(const std::wstring& s) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-  return converter.to_bytes(s);
+  return to_string(std::wstring_view(s));
+}
+
+std::string to_string(std::wstring_view s) {
+  std::string out(Utf8Size(s), '\0');
+  Utf8Encode(s, out.data());
+  return out;
 }
 
 std::wstring to_wstring(const std::string& s) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-  return converter.from_bytes(s);
+  return to_wstring(std::string_view(s));
+}
+
+std::wstring to_wstring(std::string_view s) {
+  std::wstring out;
+  Utf8Decode(s, &out);
+  return out;
+}
+
+namespace {
+
+constexpr uint32_t kNotInPalette = ~0u;
+
+// The value of a blank cell: a space, or its palette index.
+template <typename T>
+constexpr T Blank() {
+  if constexpr (std::is_same_v<T, wchar_t>)
+    return L' ';
+  else
+    return 0;
 }
 
-Screen::Screen(int width, int height)
-    : dim_x_(width),
-      dim_y_(height),
-      lines_(dim_y_, std::wstring(dim_x_, L' ')) {}
+// A 64 bits hash of |row|, mixing 8 bytes at a time.
+uint64_t HashRow(std::wstring_view row) {
+  const char* data = reinterpret_cast<const char*>(row.data());
+  const size_t size = row.size() * sizeof(wchar_t);
+  uint64_t hash = 0xcbf29ce484222325 ^ size;
+  auto mix = [&](uint64_t word) {
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+    hash ^= hash >> 29;
+  };
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    mix(word);
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    std::memcpy(&word, data + i, size - i);
+    mix(word);
+  }
+  return hash;
+}
+
+}  // namespace
+
+template <>
+std::vector<wchar_t>& Screen::Cells() {
+  return cells_;
+}
+
+template <>
+std::vector<uint8_t>& Screen::Cells() {
+  return cells_8_;
+}
+
+template <>
+std::vector<uint16_t>& Screen::Cells() {
+  return cells_16_;
+}
+
+template <typename Function>
+decltype(auto) Screen::Visit(Function function) {
+  switch (format_) {
+    case Format::Index8:
+      return function(uint8_t());
+    case Format::Index16:
+      return function(uint16_t());
+    case Format::Wide:
+    case Format::Tiled:
+      break;
+  }
+  return function(wchar_t());
+}
+
+Screen::Screen(int width, int height, Storage storage) {
+  if (storage == Storage::Compact) {
+    format_ = Format::Index8;
+    palette_ = {L' '};
+    RebuildPaletteIndex();
+  }
+  if (storage == Storage::Sparse)
+    format_ = Format::Tiled;
+  Resize(width, height);
+}
+
+Screen::~Screen() {
+  BufferPool<std::vector<wchar_t>>::Return(std::move(cells_));
+  BufferPool<std::vector<uint8_t>>::Return(std::move(cells_8_));
+  BufferPool<std::vector<uint16_t>>::Return(std::move(cells_16_));
+}
 
 void Screen::DrawPixel(int x, int y, wchar_t c) {
-  lines_[y][x] = c;
+  Set(x, y, c);
 }
 
 void Screen::DrawText(int x, int y, std::wstring_view text) {
-  for (auto& c : text)
-    lines_[y][x++] = c;
+  row_dirty_[y] = true;
+  if (format_ == Format::Wide) {
+    std::copy(text.begin(), text.end(), Row<wchar_t>(y) + x);
+    return;
+  }
+  if (format_ == Format::Tiled) {
+    while (!text.empty()) {
+      size_t size = std::min(text.size(), size_t(kTileWidth - x % kTileWidth));
+      std::copy_n(text.data(), size, TiledCell(x, y));
+      text.remove_prefix(size);
+      x += int(size);
+    }
+    return;
+  }
+  for (size_t i = 0; i < text.size(); ++i)
+    SetCompact(x + int(i), y, text[i]);
 }
 
 // ╭──╮
@@ -55,17 +165,15 @@ void Screen::DrawText(int x, int y, std::wstring_view text) {
 //  ╲______╱
 
 void Screen::DrawBox(int x, int y, int w, int h) {
-  lines_[y][x + w - 1] = L'┐';
-  lines_[y + h - 1][x + w - 1] = L'┘';
-  lines_[y][x] = L'┌';
-  lines_[y + h - 1][x] = L'└';
-  for (int xx = 1; xx < w - 1; ++xx) {
-    lines_[y][x + xx] = L'─';
-    lines_[y + h - 1][x + xx] = L'─';
-  }
+  Pixel(x + w - 1, y) = L'┐';
+  Pixel(x + w - 1, y + h - 1) = L'┘';
+  Pixel(x, y) = L'┌';
+  Pixel(x, y + h - 1) = L'└';
+  FillSpan(x + 1, y, w - 2, L'─');
+  FillSpan(x + 1, y + h - 1, w - 2, L'─');
   for (int yy = 1; yy < h - 1; ++yy) {
-    lines_[y + yy][x] = L'│';
-    lines_[y + yy][x + w - 1] = L'│';
+    Pixel(x, y + yy) = L'│';
+    Pixel(x + w - 1, y + yy) = L'│';
   }
 }
 
@@ -75,134 +183,446 @@ void Screen::DrawBoxedText(int x, int y, const std::wstring& text) {
 }
 
 std::string Screen::ToString() {
-  std::stringstream ss;
-  for (int y = 0; y < dim_y_; ++y) {
-    ss << to_string(lines_[y]) << '\n';
+  return RectToString(0, 0, dim_x_, dim_y_);
+}
+
+void Screen::Write(Sink* sink, bool trim_trailing_spaces) const {
+  WriteRect(sink, 0, 0, dim_x_, dim_y_, trim_trailing_spaces);
+}
+
+std::string Screen::RectToString(int x, int y, int width, int height) const {
+  // Compute the exact size first, so that the output is allocated once.
+  PooledBuffer<std::wstring> buffer;
+  size_t size = height;
+  for (int yy = y; yy < y + height; ++yy) {
+    size += IsBlankSpan(yy, x, width)
+                ? width
+                : Utf8Size(RowView(yy, x, width, buffer.get()));
+  }
+
+  std::string out(size, '\0');
+  char* it = out.data();
+  for (int yy = y; yy < y + height; ++yy) {
+    if (IsBlankSpan(yy, x, width))
+      it = std::fill_n(it, width, ' ');
+    else
+      it = Utf8Encode(RowView(yy, x, width, buffer.get()), it);
+    *it++ = '\n';
   }
-  return ss.str();
+  return out;
 }
 
-void Screen::DrawHorizontalLine(int left, int right, int y, wchar_t c) {
-  for (int x = left; x <= right; ++x) {
-    lines_[y][x] = c;
+void Screen::WriteRect(Sink* sink,
+                       int x,
+                       int y,
+                       int width,
+                       int height,
+                       bool trim_trailing_spaces) const {
+  constexpr size_t kBatchSize = 1 << 16;
+  PooledBuffer<std::string> batch(kBatchSize);
+  PooledBuffer<std::wstring> buffer;
+  for (int yy = y; yy < y + height; ++yy) {
+    // Blank rows are written without being decoded.
+    bool blank = IsBlankSpan(yy, x, width);
+    std::wstring_view line =
+        blank ? std::wstring_view() : RowView(yy, x, width, buffer.get());
+    if (trim_trailing_spaces)
+      line = line.substr(0, line.find_last_not_of(L' ') + 1);
+    size_t spaces = blank && !trim_trailing_spaces ? width : 0;
+
+    size_t size = spaces + Utf8Size(line) + 1;
+    if (batch->size() + size > kBatchSize && !batch->empty()) {
+      sink->Write(*batch);
+      batch->clear();
+    }
+    size_t offset = batch->size();
+    batch->resize(offset + size);
+    char* it = std::fill_n(batch->data() + offset, spaces, ' ');
+    *Utf8Encode(line, it) = '\n';
   }
+  if (!batch->empty())
+    sink->Write(*batch);
+}
+
+void Screen::DrawHorizontalLine(int left, int right, int y, wchar_t c) {
+  FillSpan(left, y, right - left + 1, c);
 }
 
 void Screen::DrawVerticalLine(int top, int bottom, int x, wchar_t c) {
   for (int y = top; y <= bottom; ++y) {
-    lines_[y][x] = c;
+    Set(x, y, c);
   }
 }
 
+void Screen::FillRect(int x, int y, int width, int height, wchar_t c) {
+  for (int yy = y; yy < y + height; ++yy)
+    FillSpan(x, yy, width, c);
+}
+
 void Screen::DrawVerticalLineComplete(int top, int bottom, int x) {
   for (int y = top; y <= bottom; ++y) {
-    auto& p = Pixel(x, y);
-    if (p == L'─') {
-      bool left = (x != 0 && Pixel(x - 1, y) != L' ');
-      bool right = (x != dim_x_ - 1 && Pixel(x + 1, y) != L' ');
-      if (y == top) {
-        if (left && right)
-          p = L'┬';
-        else if (left)
-          p = L'┐';
-        else if (right)
-          p = L'┌';
-        else
-          p = L'┼';
-      } else if (y == bottom) {
-        if (left && right)
-          p = L'┴';
-        else if (left)
-          p = L'┘';
-        else if (right)
-          p = L'└';
-        else
-          p = L'┼';
-      } else {
-        if (left && right)
-          p = L'┼';
-        else if (left)
-          p = L'┤';
-        else if (right)
-          p = L'├';
-        else
-          p = L'┼';
-      }
-    } else {
-      // clang-format off
-      switch(p) {
-        case L'┐': p = L'┤'; break;
-        case L'┘': p = L'┤'; break;
-        case L'┌': p = L'├'; break;
-        case L'└': p = L'├'; break;
-        case L'┬': p = L'┼'; break;
-        case L'┴': p = L'┼'; break;
-        default:   p = L'│'; break;
-      }
-      // clang-format on
+    int mask = ConnectionMask(Get(x, y));
+
+    // A horizontal line keeps its arms toward non blank neighbours only. The
+    // vertical line stops there at its ends.
+    if (mask == (kLeft | kRight)) {
+      int arms = 0;
+      if (x != 0 && Get(x - 1, y) != L' ')
+        arms |= kLeft;
+      if (x != dim_x_ - 1 && Get(x + 1, y) != L' ')
+        arms |= kRight;
+      int vertical = (y == top)      ? kDown
+                     : (y == bottom) ? kUp
+                                     : kUp | kDown;
+      // Without neighbours, the line crosses it.
+      Set(x, y, arms ? ConnectionGlyph(arms | vertical) : L'┼');
+      continue;
     }
+
+    // Corners and T junctions with a single vertical arm are extended through.
+    // Any other cell is replaced by the line.
+    bool horizontal = mask & (kLeft | kRight);
+    bool half_vertical = !(mask & kUp) != !(mask & kDown);
+    if (horizontal && half_vertical)
+      Set(x, y, ConnectionGlyph(mask | kUp | kDown));
+    else
+      Set(x, y, L'│');
   }
 }
 
-// clang-format off
+void Screen::Connect(int x, int y, int mask) {
+  if (int current = ConnectionMask(Get(x, y)))
+    Set(x, y, ConnectionGlyph(current | mask));
+}
+
 void Screen::ASCIIfy(int style) {
-  if (style == 0) {
-    for(auto& line : lines_) {
-      for(auto& c : line) {
-        switch(c) {
-          case L'─': c = '-'; break;
-          case L'│': c = '|'; break;
-          case L'┐': c = '.'; break;
-          case L'┘': c = '\''; break;
-          case L'┌': c = '.'; break;
-          case L'└': c = '\''; break;
-          case L'┬': c = '-'; break;
-          case L'┴': c = '-'; break;
-          case L'├': c = '-'; break;
-          case L'┤': c = '-'; break;
-          case L'△': c = '^'; break;
-          case L'▽': c = 'V'; break;
-        }
-      }
+  if (const Charset* charset = GetCharset(style))
+    ASCIIfy(*charset);
+}
+
+void Screen::ASCIIfy(const Charset& charset) {
+  std::fill(row_dirty_.begin(), row_dirty_.end(), true);
+  if (format_ == Format::Wide) {
+    for (int y = 0; y < dim_y_; ++y)
+      charset.Apply(Row<wchar_t>(y), Row<wchar_t>(y) + dim_x_);
+    return;
+  }
+
+  if (format_ == Format::Tiled) {
+    for (std::shared_ptr<Tile>& tile : tiles_) {
+      if (tile == BlankTile())
+        continue;
+      if (tile.use_count() != 1)
+        tile = std::make_shared<Tile>(*tile);
+      charset.Apply(tile->data(), tile->data() + tile->size());
+    }
+    return;
+  }
+
+  // Only the palette needs to be replaced. The blank glyph stays at index 0.
+  charset.Apply(palette_.data() + 1, palette_.data() + palette_.size());
+  RebuildPaletteIndex();
+}
+
+std::wstring Screen::Line(int y) const {
+  PooledBuffer<std::wstring> buffer;
+  return std::wstring(RowView(y, buffer.get()));
+}
+
+uint64_t Screen::RowHash(int y) const {
+  if (!row_dirty_[y])
+    return row_hashes_[y];
+
+  PooledBuffer<std::wstring> buffer;
+  row_hashes_[y] = HashRow(RowView(y, buffer.get()));
+  row_dirty_[y] = false;
+  return row_hashes_[y];
+}
+
+ScreenDiff Screen::Diff(const Screen& previous) const {
+  ScreenDiff diff;
+  diff.width = dim_x_;
+  diff.height = dim_y_;
+  bool same_width = dim_x_ == previous.dim_x_;
+  PooledBuffer<std::wstring> buffer;
+  for (int y = 0; y < dim_y_; ++y) {
+    if (same_width && y < previous.dim_y_ &&
+        RowHash(y) == previous.RowHash(y)) {
+      continue;
+    }
+    if (diff.ranges.empty() ||
+        diff.ranges.back().begin + int(diff.ranges.back().rows.size()) != y) {
+      diff.ranges.emplace_back();
+      diff.ranges.back().begin = y;
+    }
+    diff.ranges.back().rows.push_back(to_string(RowView(y, buffer.get())));
+  }
+  return diff;
+}
+
+std::wstring_view Screen::RowView(int y,
+                                  int x,
+                                  int size,
+                                  std::wstring* buffer) const {
+  size_t offset = size_t(y) * stride_ + x;
+  if (format_ == Format::Wide)
+    return std::wstring_view(cells_.data() + offset, size);
+
+  buffer->resize(size);
+  if (format_ == Format::Tiled) {
+    for (int i = 0; i < size;) {
+      int part = std::min(size - i, kTileWidth - (x + i) % kTileWidth);
+      const Tile& tile = *tiles_[TileIndex(x + i, y)];
+      std::copy_n(tile.data() + (y % kTileHeight) * kTileWidth +
+                      (x + i) % kTileWidth,
+                  part, buffer->data() + i);
+      i += part;
     }
+    return *buffer;
+  }
+
+  for (int i = 0; i < size; ++i) {
+    (*buffer)[i] = palette_[format_ == Format::Index8 ? cells_8_[offset + i]
+                                                      : cells_16_[offset + i]];
+  }
+  return *buffer;
+}
+
+wchar_t Screen::GetCompact(int x, int y) const {
+  size_t i = size_t(y) * stride_ + x;
+  return palette_[format_ == Format::Index8 ? cells_8_[i] : cells_16_[i]];
+}
+
+void Screen::SetCompact(int x, int y, wchar_t c) {
+  uint32_t value = Intern(c);
+  Visit([&](auto tag) {
+    using T = decltype(tag);
+    Row<T>(y)[x] = T(value);
+  });
+}
+
+void Screen::FillSpan(int x, int y, int size, wchar_t c) {
+  if (size <= 0)
+    return;
+  row_dirty_[y] = true;
+  if (format_ == Format::Tiled) {
+    FillTiled(x, y, size, c);
     return;
   }
+  uint32_t value = format_ == Format::Wide ? uint32_t(c) : Intern(c);
+  Visit([&](auto tag) {
+    using T = decltype(tag);
+    std::fill(Row<T>(y) + x, Row<T>(y) + x + size, T(value));
+  });
+}
+
+const std::shared_ptr<Screen::Tile>& Screen::BlankTile() {
+  // Never written to, since tiles are unshared before being written.
+  static const auto blank = [] {
+    auto tile = std::make_shared<Tile>();
+    tile->fill(L' ');
+    return tile;
+  }();
+  return blank;
+}
 
-  if (style == 1) {
-    for(auto& line : lines_) {
-      for(auto& c : line) {
-        switch(c) {
-          case L'─': c = '-'; break;
-          case L'│': c = '|'; break;
-          case L'┐': c = '.'; break;
-          case L'┘': c = '\''; break;
-          case L'┌': c = '.'; break;
-          case L'└': c = '\''; break;
-          case L'┬': c = '.'; break;
-          case L'┴': c = '\''; break;
-          case L'├': c = '-'; break;
-          case L'┤': c = '-'; break;
-          case L'△': c = '^'; break;
-          case L'▽': c = 'V'; break;
-        }
+wchar_t* Screen::TiledCell(int x, int y) {
+  std::shared_ptr<Tile>& tile = tiles_[TileIndex(x, y)];
+  if (tile.use_count() != 1)
+    tile = std::make_shared<Tile>(*tile);
+  return tile->data() + (y % kTileHeight) * kTileWidth + x % kTileWidth;
+}
+
+void Screen::FillTiled(int x, int y, int size, wchar_t c) {
+  while (size > 0) {
+    int part = std::min(size, kTileWidth - x % kTileWidth);
+    if (c != L' ' || tiles_[TileIndex(x, y)] != BlankTile())
+      std::fill_n(TiledCell(x, y), part, c);
+    size -= part;
+    x += part;
+  }
+}
+
+bool Screen::IsBlankSpan(int y, int x, int size) const {
+  if (format_ != Format::Tiled || size <= 0)
+    return false;
+  const std::shared_ptr<Tile>& blank = BlankTile();
+  int last = (x + size - 1) / kTileWidth;
+  for (int tile = x / kTileWidth; tile <= last; ++tile) {
+    if (tiles_[TileIndex(tile * kTileWidth, y)] != blank)
+      return false;
+  }
+  return true;
+}
+
+void Screen::ResizeTiled(int new_dim_x, int new_dim_y) {
+  auto round_up = [](int value, int size) {
+    return (value + size - 1) / size * size;
+  };
+
+  // Grow the grid geometrically.
+  if (new_dim_x > stride_ || new_dim_y > capacity_y_) {
+    int stride = new_dim_x > stride_
+                     ? round_up(std::max(new_dim_x, 2 * stride_), kTileWidth)
+                     : stride_;
+    int rows = new_dim_y > capacity_y_
+                   ? round_up(std::max(new_dim_y, 2 * capacity_y_), kTileHeight)
+                   : capacity_y_;
+    std::vector<std::shared_ptr<Tile>> tiles(
+        size_t(stride / kTileWidth) * (rows / kTileHeight), BlankTile());
+    for (int y = 0; y < capacity_y_; y += kTileHeight) {
+      for (int x = 0; x < stride_; x += kTileWidth) {
+        tiles[size_t(y / kTileHeight) * (stride / kTileWidth) +
+              x / kTileWidth] = std::move(tiles_[TileIndex(x, y)]);
       }
     }
+    tiles_ = std::move(tiles);
+    stride_ = stride;
+    capacity_y_ = rows;
+  }
+
+  // Release the tiles no longer in use, and blank the cells no longer in use
+  // in the others.
+  for (int y = 0; y < dim_y_; y += kTileHeight) {
+    for (int x = 0; x < dim_x_; x += kTileWidth) {
+      if (x >= new_dim_x || y >= new_dim_y)
+        tiles_[TileIndex(x, y)] = BlankTile();
+    }
+  }
+  for (int y = 0; y < dim_y_; ++y) {
+    int left = y < new_dim_y ? new_dim_x : 0;
+    if (left < dim_x_)
+      FillTiled(left, y, dim_x_ - left, L' ');
+  }
+}
+
+uint32_t Screen::Intern(wchar_t c) {
+  // A previous call may have moved the cells to |Format::Wide|, e.g. in the
+  // middle of a |DrawText|.
+  if (format_ == Format::Wide)
+    return uint32_t(c);
+
+  if (c >= 0 && c < 128) {
+    if (palette_index_ascii_[c] != kNotInPalette)
+      return palette_index_ascii_[c];
+  } else {
+    auto it = palette_index_.find(c);
+    if (it != palette_index_.end())
+      return it->second;
+  }
+
+  size_t index = palette_.size();
+  if ((format_ == Format::Index8 && index == 0x100) ||
+      (format_ == Format::Index16 && index == 0x10000)) {
+    Promote();
+    if (format_ == Format::Wide)
+      return uint32_t(c);
+  }
+
+  palette_.push_back(c);
+  if (c >= 0 && c < 128)
+    palette_index_ascii_[c] = uint32_t(index);
+  else
+    palette_index_[c] = uint16_t(index);
+  return uint32_t(index);
+}
+
+void Screen::Promote() {
+  if (format_ == Format::Index8) {
+    cells_16_ = BufferPool<std::vector<uint16_t>>::Take(cells_8_.size());
+    cells_16_.assign(cells_8_.begin(), cells_8_.end());
+    BufferPool<std::vector<uint8_t>>::Return(std::move(cells_8_));
+    cells_8_ = {};
+    format_ = Format::Index16;
     return;
   }
+
+  cells_ = BufferPool<std::vector<wchar_t>>::Take(cells_16_.size());
+  cells_.resize(cells_16_.size());
+  for (size_t i = 0; i < cells_16_.size(); ++i)
+    cells_[i] = palette_[cells_16_[i]];
+  BufferPool<std::vector<uint16_t>>::Return(std::move(cells_16_));
+  cells_16_ = {};
+  palette_ = {};
+  palette_index_ = {};
+  palette_index_ascii_.fill(kNotInPalette);
+  format_ = Format::Wide;
+}
+
+void Screen::RebuildPaletteIndex() {
+  palette_index_ascii_.fill(kNotInPalette);
+  palette_index_.clear();
+  for (size_t i = 0; i < palette_.size(); ++i) {
+    wchar_t c = palette_[i];
+    if (c >= 0 && c < 128) {
+      if (palette_index_ascii_[c] == kNotInPalette)
+        palette_index_ascii_[c] = uint32_t(i);
+    } else {
+      palette_index_.emplace(c, uint16_t(i));
+    }
+  }
 }
 
-wchar_t& Screen::Pixel(int x, int y) {
-  return lines_[y][x];
+template <typename T>
+void Screen::Reserve(int stride, int rows) {
+  std::vector<T>& cells = Cells<T>();
+  size_t size = size_t(stride) * rows;
+  if (stride == stride_ && size <= cells.capacity()) {
+    cells.resize(size, Blank<T>());
+    capacity_y_ = rows;
+    return;
+  }
+
+  std::vector<T> resized = BufferPool<std::vector<T>>::Take(size);
+  resized.resize(size, Blank<T>());
+  for (int y = 0; y < dim_y_; ++y)
+    std::copy(Row<T>(y), Row<T>(y) + dim_x_,
+              resized.data() + size_t(y) * stride);
+  std::swap(cells, resized);
+  BufferPool<std::vector<T>>::Return(std::move(resized));
+  stride_ = stride;
+  capacity_y_ = rows;
 }
 
 void Screen::Resize(int new_dim_x, int new_dim_y) {
-  dim_x_ = new_dim_x;
-  dim_y_ = new_dim_y;
+  if (new_dim_x < 0 || new_dim_y < 0)
+    throw std::length_error("Screen::Resize: negative dimension");
+
+  if (new_dim_x != dim_x_)
+    std::fill(row_dirty_.begin(), row_dirty_.end(), true);
+  row_hashes_.resize(new_dim_y);
+  row_dirty_.resize(new_dim_y, true);
 
-  lines_.resize(dim_y_);
-  for (auto& line : lines_) {
-    line.resize(dim_x_, L' ');
+  if (format_ == Format::Tiled) {
+    ResizeTiled(new_dim_x, new_dim_y);
+    dim_x_ = new_dim_x;
+    dim_y_ = new_dim_y;
+    return;
   }
+
+  Visit([&](auto tag) {
+    using T = decltype(tag);
+
+    // Grow the storage geometrically.
+    if (new_dim_x > stride_ || new_dim_y > capacity_y_) {
+      Reserve<T>(
+          new_dim_x > stride_ ? std::max(new_dim_x, 2 * stride_) : stride_,
+          new_dim_y > capacity_y_ ? std::max(new_dim_y, 2 * capacity_y_)
+                                  : capacity_y_);
+    }
+
+    // Blank the cells no longer in use, so that they are blank again when the
+    // screen grows back.
+    for (int y = 0; y < std::min(dim_y_, new_dim_y); ++y) {
+      if (new_dim_x < dim_x_)
+        std::fill(Row<T>(y) + new_dim_x, Row<T>(y) + dim_x_, Blank<T>());
+    }
+    for (int y = new_dim_y; y < dim_y_; ++y)
+      std::fill(Row<T>(y), Row<T>(y) + dim_x_, Blank<T>());
+  });
+
+  dim_x_ = new_dim_x;
+  dim_y_ = new_dim_y;
 }
 
 void Screen::Append(const Screen& other, int x, int y) {
@@ -210,10 +630,11 @@ void Screen::Append(const Screen& other, int x, int y) {
          std::max(dim_y_, y + other.dim_y_));
 
   // Write
-  for (size_t dy = 0; dy < other.dim_y_; ++dy) {
-    for (size_t dx = 0; dx < other.dim_x_; ++dx) {
-      lines_[y + dy][x + dx] = other.lines_[dy][dx];
-    }
+  PooledBuffer<std::wstring> buffer;
+  for (int dy = 0; dy < other.dim_y_; ++dy) {
+    if (other.IsBlankRow(dy))
+      FillSpan(x, y + dy, other.dim_x_, L' ');
+    else
+      DrawText(x, y + dy, other.RowView(dy, buffer.get()));
   }
 }
-// clang-format on
@@ -1,38 +1,255 @@
 #ifndef SCREEN_H
 #define SCREEN_H
 
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 std::string to_string(const std::wstring& s);
+std::string to_string(std::wstring_view s);
 std::wstring to_wstring(const std::string& s);
+std::wstring to_wstring(std::string_view s);
+
+class Charset;
+class Sink;
+
+// The rows of a screen differing from a previous one. See |Screen::Diff|.
+struct ScreenDiff {
+  // Consecutive rows, starting at row |begin|. They are encoded as UTF-8,
+  // without the trailing newline.
+  struct Range {
+    int begin = 0;
+    std::vector<std::string> rows;
+  };
+
+  // The dimensions of the new screen. Rows past |height| must be removed.
+  int width = 0;
+  int height = 0;
+  std::vector<Range> ranges;
+};
 
 class Screen {
  public:
+  enum class Storage {
+    // One wchar_t per cell.
+    Wide,
+    // One or two bytes per cell, indexing a palette of the glyphs in use. It
+    // uses 2 to 4 times less memory, at the cost of slower drawing.
+    Compact,
+    // Tiles of 64x16 cells, allocated when something is drawn into them. The
+    // memory used depends on the drawn content, not on the screen size. This
+    // fits large and mostly blank screens.
+    Sparse,
+  };
+
+  // Reference to a cell, used like a wchar_t&.
+  class Cell {
+   public:
+    operator wchar_t() const { return screen_.Get(x_, y_); }
+    Cell& operator=(wchar_t c) {
+      screen_.Set(x_, y_, c);
+      return *this;
+    }
+    Cell& operator=(const Cell& other) { return *this = wchar_t(other); }
+
+   private:
+    friend class Screen;
+    Cell(Screen& screen, int x, int y) : screen_(screen), x_(x), y_(y) {}
+    Screen& screen_;
+    int x_;
+    int y_;
+  };
+
   Screen() = default;
-  Screen(int width, int height);
+  Screen(int width, int height, Storage storage = Storage::Wide);
+  // The cell buffers are borrowed from, and returned to, the thread-local
+  // pools of screen/BufferPool.h.
+  ~Screen();
+  Screen(const Screen&) = default;
+  Screen(Screen&&) = default;
+  Screen& operator=(const Screen&) = default;
+  Screen& operator=(Screen&&) = default;
   void DrawPixel(int x, int y, wchar_t c);
   void DrawText(int x, int y, std::wstring_view text);
   void DrawBox(int x, int y, int w, int h);
   void DrawBoxedText(int x, int y, const std::wstring& text);
   void DrawHorizontalLine(int left, int right, int y, wchar_t c = L'─');
   void DrawVerticalLine(int top, int bottom, int x, wchar_t c = L'│');
+  // Set |size| cells of the row |y| to |c|, starting at |x|.
+  void FillSpan(int x, int y, int size, wchar_t c);
+  void FillRect(int x, int y, int width, int height, wchar_t c);
+  // Draw a vertical line, merging it with the lines it crosses. It forms a T
+  // junction where it ends on a horizontal line.
   void DrawVerticalLineComplete(int top, int bottom, int x);
+  // Add the |mask| directions to the line at (x, y). See screen/Connection.h.
+  // Cells not part of a line are left untouched.
+  void Connect(int x, int y, int mask);
+  // Replace the characters using the charset registered as |style|. See
+  // screen/Charset.h.
   void ASCIIfy(int style = 0);
+  void ASCIIfy(const Charset& charset);
   std::string ToString();
-  wchar_t& Pixel(int x, int y);
 
+  // Same as |ToString|, but write the output to |sink| in batches of rows, so
+  // that it is never held entirely in memory.
+  void Write(Sink* sink, bool trim_trailing_spaces = false) const;
+
+  Cell Pixel(int x, int y) { return Cell(*this, x, y); }
+  wchar_t Pixel(int x, int y) const { return Get(x, y); }
+
+  // Grow or shrink the screen. The capacity grows geometrically, so that
+  // successive calls cost amortized linear time.
   void Resize(int dim_x, int dim_y);
   void Append(const Screen& other, int x, int y);
 
   int width() const { return dim_x_; }
   int height() const { return dim_y_; }
+  Storage storage() const {
+    switch (format_) {
+      case Format::Wide:
+        return Storage::Wide;
+      case Format::Tiled:
+        return Storage::Sparse;
+      default:
+        return Storage::Compact;
+    }
+  }
+
+  // The |y|-th row, limited to |width()| cells.
+  std::wstring Line(int y) const;
+
+  // A 64 bits hash of the |y|-th row. It is cached until the row is drawn
+  // into.
+  uint64_t RowHash(int y) const;
+
+  // The rows differing from |previous|, for a client to patch the previous
+  // output instead of receiving the whole output. Rows are compared through
+  // |RowHash|.
+  ScreenDiff Diff(const Screen& previous) const;
 
  private:
+  friend class InternedRows;
+  friend class LayeredScreen;
+  friend class ScreenView;
+
+  // How the cells are stored. Compact screens start with |Index8|, and move
+  // to larger formats as the palette grows.
+  enum class Format {
+    Wide,
+    Index8,
+    Index16,
+    Tiled,
+  };
+
+  static constexpr int kTileWidth = 64;
+  static constexpr int kTileHeight = 16;
+  using Tile = std::array<wchar_t, kTileWidth * kTileHeight>;
+
+  wchar_t Get(int x, int y) const {
+    if (format_ == Format::Wide)
+      return cells_[size_t(y) * stride_ + x];
+    if (format_ == Format::Tiled)
+      return GetTiled(x, y);
+    return GetCompact(x, y);
+  }
+  void Set(int x, int y, wchar_t c) {
+    row_dirty_[y] = true;
+    if (format_ == Format::Wide)
+      cells_[size_t(y) * stride_ + x] = c;
+    else if (format_ == Format::Tiled)
+      *TiledCell(x, y) = c;
+    else
+      SetCompact(x, y, c);
+  }
+  wchar_t GetCompact(int x, int y) const;
+  void SetCompact(int x, int y, wchar_t c);
+
+  // Tiled screens only.
+  wchar_t GetTiled(int x, int y) const {
+    const Tile& tile = *tiles_[TileIndex(x, y)];
+    return tile[(y % kTileHeight) * kTileWidth + x % kTileWidth];
+  }
+  size_t TileIndex(int x, int y) const {
+    return size_t(y / kTileHeight) * (stride_ / kTileWidth) + x / kTileWidth;
+  }
+  // The cell at (x, y), allocating or unsharing its tile first. The cells up
+  // to the end of the tile row follow it.
+  wchar_t* TiledCell(int x, int y);
+  // Whether the |size| cells of the |y|-th row starting at |x| only cross the
+  // shared blank tile.
+  bool IsBlankSpan(int y, int x, int size) const;
+  bool IsBlankRow(int y) const { return IsBlankSpan(y, 0, dim_x_); }
+  // Same as |FillSpan|. Filling blank tiles with spaces doesn't allocate them.
+  void FillTiled(int x, int y, int size, wchar_t c);
+  void ResizeTiled(int dim_x, int dim_y);
+  static const std::shared_ptr<Tile>& BlankTile();
+
+  // The |size| cells of the |y|-th row starting at |x|, as wchar_t. Compact
+  // and tiled rows are decoded into |buffer|.
+  std::wstring_view RowView(int y, int x, int size, std::wstring* buffer) const;
+  std::wstring_view RowView(int y, std::wstring* buffer) const {
+    return RowView(y, 0, dim_x_, buffer);
+  }
+
+  // |ToString| and |Write|, limited to a rectangle of the screen.
+  std::string RectToString(int x, int y, int width, int height) const;
+  void WriteRect(Sink* sink,
+                 int x,
+                 int y,
+                 int width,
+                 int height,
+                 bool trim_trailing_spaces) const;
+
+  // Calls |function| with a value of the type the cells are stored as.
+  template <typename Function>
+  decltype(auto) Visit(Function function);
+  template <typename T>
+  std::vector<T>& Cells();
+  template <typename T>
+  T* Row(int y) {
+    return Cells<T>().data() + size_t(y) * stride_;
+  }
+  template <typename T>
+  void Reserve(int stride, int rows);
+
+  // Returns the palette index of |c|, adding it when needed. This may move the
+  // cells to a larger format. When it moves them to |Format::Wide|, |c| itself
+  // is returned.
+  uint32_t Intern(wchar_t c);
+  void Promote();
+  void RebuildPaletteIndex();
+
   int dim_x_ = 0;
   int dim_y_ = 0;
-  std::vector<std::wstring> lines_;
+
+  // One entry per row. A row is dirty when it was drawn into since its hash
+  // was computed.
+  mutable std::vector<uint64_t> row_hashes_;
+  mutable std::vector<uint8_t> row_dirty_;
+
+  // The cells are stored in a single row-major buffer. Every row is |stride_|
+  // cells long and there is room for |capacity_y_| rows. Cells outside of
+  // |dim_x_| x |dim_y_| are always blank.
+  int stride_ = 0;
+  int capacity_y_ = 0;
+  Format format_ = Format::Wide;
+  std::vector<wchar_t> cells_;
+  std::vector<uint8_t> cells_8_;
+  std::vector<uint16_t> cells_16_;
+
+  // Tiled screens only. The tiles form a grid of |stride_| x |capacity_y_|
+  // cells. Blank tiles all point to the same shared tile, and the other ones
+  // are copied on write when shared with a copy of the screen.
+  std::vector<std::shared_ptr<Tile>> tiles_;
+
+  // Compact screens only. The blank glyph is always at index 0.
+  std::vector<wchar_t> palette_;
+  std::array<uint32_t, 128> palette_index_ascii_ = {};
+  std::unordered_map<wchar_t, uint16_t> palette_index_;
 };
 
 #endif /* end of include guard: SCREEN_H */
@@ -0,0 +1,83 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/ScreenView.h"
+
+#include <algorithm>
+
+#include "screen/BufferPool.h"
+#include "screen/Screen.h"
+
+ScreenView::ScreenView(Screen* screen)
+    : ScreenView(screen, 0, 0, screen->width(), screen->height()) {}
+
+ScreenView::ScreenView(Screen* screen, int x, int y, int width, int height)
+    : screen_(screen) {
+  x_ = std::clamp(x, 0, screen->width());
+  y_ = std::clamp(y, 0, screen->height());
+  width_ = std::clamp(x + width, x_, screen->width()) - x_;
+  height_ = std::clamp(y + height, y_, screen->height()) - y_;
+}
+
+ScreenView ScreenView::Crop(int x, int y, int width, int height) const {
+  // Clamp to this view first, the constructor clamps to the screen.
+  int left = std::clamp(x, 0, width_);
+  int top = std::clamp(y, 0, height_);
+  int right = std::clamp(x + width, left, width_);
+  int bottom = std::clamp(y + height, top, height_);
+  return ScreenView(screen_, x_ + left, y_ + top, right - left, bottom - top);
+}
+
+bool ScreenView::Clip(int& x, int y, int& size, int& skip) const {
+  if (y < 0 || y >= height_)
+    return false;
+  skip = std::max(0, -x);
+  x += skip;
+  size = std::min(size - skip, width_ - x);
+  return size > 0;
+}
+
+void ScreenView::DrawPixel(int x, int y, wchar_t c) {
+  FillSpan(x, y, 1, c);
+}
+
+void ScreenView::DrawText(int x, int y, std::wstring_view text) {
+  int size = int(text.size());
+  int skip = 0;
+  if (Clip(x, y, size, skip))
+    screen_->DrawText(x_ + x, y_ + y, text.substr(skip, size));
+}
+
+void ScreenView::FillSpan(int x, int y, int size, wchar_t c) {
+  int skip = 0;
+  if (Clip(x, y, size, skip))
+    screen_->FillSpan(x_ + x, y_ + y, size, c);
+}
+
+void ScreenView::Append(const Screen& other, int x, int y) {
+  // Only the rows and columns of |other| inside the view are read.
+  int skip_y = std::max(0, -y);
+  int end_y = std::min(other.height(), height_ - y);
+  PooledBuffer<std::wstring> buffer;
+  for (int dy = skip_y; dy < end_y; ++dy) {
+    int left = x;
+    int size = other.width();
+    int skip = 0;
+    if (!Clip(left, y + dy, size, skip))
+      return;
+    if (other.IsBlankSpan(dy, skip, size))
+      screen_->FillSpan(x_ + left, y_ + y + dy, size, L' ');
+    else
+      screen_->DrawText(x_ + left, y_ + y + dy,
+                        other.RowView(dy, skip, size, buffer.get()));
+  }
+}
+
+std::string ScreenView::ToString() const {
+  return screen_->RectToString(x_, y_, width_, height_);
+}
+
+void ScreenView::Write(Sink* sink, bool trim_trailing_spaces) const {
+  screen_->WriteRect(sink, x_, y_, width_, height_, trim_trailing_spaces);
+}
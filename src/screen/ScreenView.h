@@ -0,0 +1,49 @@
+#ifndef SCREEN_SCREEN_VIEW_H
+#define SCREEN_SCREEN_VIEW_H
+
+#include <string>
+#include <string_view>
+
+class Screen;
+class Sink;
+
+// A rectangle of a |Screen|, drawn into and read without being copied. The
+// coordinates are relative to the top-left corner of the rectangle, and what
+// is drawn outside of it is clipped. The view doesn't own the screen, and is
+// invalidated when the screen is resized.
+class ScreenView {
+ public:
+  // The whole |screen|.
+  explicit ScreenView(Screen* screen);
+  // The rectangle is clamped to the bounds of |screen|.
+  ScreenView(Screen* screen, int x, int y, int width, int height);
+
+  // A rectangle of this view, clamped to its bounds.
+  ScreenView Crop(int x, int y, int width, int height) const;
+
+  void DrawPixel(int x, int y, wchar_t c);
+  void DrawText(int x, int y, std::wstring_view text);
+  void FillSpan(int x, int y, int size, wchar_t c);
+  // Copy |other| at (x, y).
+  void Append(const Screen& other, int x, int y);
+
+  std::string ToString() const;
+  void Write(Sink* sink, bool trim_trailing_spaces = false) const;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+ private:
+  // Clip the span of |size| cells starting at (x, y) to the view. Returns
+  // false when nothing is left. On return, |skip| is the number of cells
+  // removed at the start.
+  bool Clip(int& x, int y, int& size, int& skip) const;
+
+  Screen* screen_;
+  int x_ = 0;
+  int y_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+};
+
+#endif /* end of include guard: SCREEN_SCREEN_VIEW_H */
@@ -0,0 +1,135 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/Sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <ostream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+class FileDescriptor : public Sink {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+
+#if defined(_WIN32)
+  void Write(const std::string_view* parts, size_t count) override {
+    for (size_t i = 0; i < count; ++i) {
+      const char* data = parts[i].data();
+      size_t size = parts[i].size();
+      while (size) {
+        unsigned chunk = unsigned(std::min<size_t>(size, 1 << 30));
+        int written = _write(fd_, data, chunk);
+        if (written < 0)
+          return;
+        data += written;
+        size -= written;
+      }
+    }
+  }
+#else
+  void Write(const std::string_view* parts, size_t count) override {
+    // Gather the parts, and write them with as few system calls as possible.
+    // Partial writes resume where they stopped.
+    constexpr size_t kMaxParts = 64;
+    while (count) {
+      iovec vectors[kMaxParts];
+      size_t n = std::min(count, kMaxParts);
+      for (size_t i = 0; i < n; ++i) {
+        vectors[i].iov_base = const_cast<char*>(parts[i].data());
+        vectors[i].iov_len = parts[i].size();
+      }
+
+      iovec* it = vectors;
+      iovec* end = vectors + n;
+      while (it != end) {
+        ssize_t written = writev(fd_, it, int(end - it));
+        if (written < 0) {
+          if (errno == EINTR)
+            continue;
+          return;
+        }
+        while (it != end && size_t(written) >= it->iov_len) {
+          written -= it->iov_len;
+          ++it;
+        }
+        if (it != end) {
+          it->iov_base = static_cast<char*>(it->iov_base) + written;
+          it->iov_len -= written;
+        }
+      }
+
+      parts += n;
+      count -= n;
+    }
+  }
+#endif
+
+ private:
+  int fd_;
+};
+
+class Stream : public Sink {
+ public:
+  explicit Stream(std::ostream& stream) : stream_(stream) {}
+  void Write(const std::string_view* parts, size_t count) override {
+    for (size_t i = 0; i < count; ++i)
+      stream_.write(parts[i].data(), parts[i].size());
+  }
+
+ private:
+  std::ostream& stream_;
+};
+
+class Callback : public Sink {
+ public:
+  explicit Callback(std::function<void(std::string_view)> callback)
+      : callback_(std::move(callback)) {}
+  void Write(const std::string_view* parts, size_t count) override {
+    for (size_t i = 0; i < count; ++i)
+      callback_(parts[i]);
+  }
+
+ private:
+  std::function<void(std::string_view)> callback_;
+};
+
+class String : public Sink {
+ public:
+  explicit String(std::string* output) : output_(output) {}
+  void Write(const std::string_view* parts, size_t count) override {
+    for (size_t i = 0; i < count; ++i)
+      output_->append(parts[i]);
+  }
+
+ private:
+  std::string* output_;
+};
+
+}  // namespace
+
+SinkPtr FileDescriptorSink(int fd) {
+  return std::make_unique<FileDescriptor>(fd);
+}
+
+SinkPtr StreamSink(std::ostream& stream) {
+  return std::make_unique<Stream>(stream);
+}
+
+SinkPtr CallbackSink(std::function<void(std::string_view)> callback) {
+  return std::make_unique<Callback>(std::move(callback));
+}
+
+SinkPtr StringSink(std::string* output) {
+  return std::make_unique<String>(output);
+}
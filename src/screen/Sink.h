@@ -0,0 +1,35 @@
+#ifndef SCREEN_SINK_H
+#define SCREEN_SINK_H
+
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Destination of an output written in pieces, e.g. by |Screen::Write|.
+class Sink {
+ public:
+  virtual ~Sink() = default;
+
+  // Write the |count| |parts| in order, like writev(2).
+  virtual void Write(const std::string_view* parts, size_t count) = 0;
+
+  void Write(std::string_view part) { Write(&part, 1); }
+};
+
+using SinkPtr = std::unique_ptr<Sink>;
+
+// Write to a file descriptor, without buffering.
+SinkPtr FileDescriptorSink(int fd);
+
+// Write to a std::ostream.
+SinkPtr StreamSink(std::ostream& stream);
+
+// Pass every part to |callback|.
+SinkPtr CallbackSink(std::function<void(std::string_view)> callback);
+
+// Append to |output|.
+SinkPtr StringSink(std::string* output);
+
+#endif /* end of include guard: SCREEN_SINK_H */
@@ -0,0 +1,282 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "screen/Utf8.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIAGON_UTF8_SSE2
+#endif
+
+namespace {
+
+// Number of wchar_t processed at once by the ASCII fast path.
+constexpr ptrdiff_t kBlock = 16;
+
+// Returns whether the |kBlock| characters starting at |input| are all ASCII.
+// When |write| is true, they are also narrowed into |output|.
+template <bool write>
+bool AsciiBlock(const wchar_t* input, char* output) {
+#if defined(DIAGON_UTF8_SSE2)
+  auto load = [&](int i) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+  };
+  if constexpr (sizeof(wchar_t) == 4) {
+    __m128i a = load(0);
+    __m128i b = load(1);
+    __m128i c = load(2);
+    __m128i d = load(3);
+    __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+    __m128i high = _mm_and_si128(any, _mm_set1_epi32(~0x7F));
+    __m128i ascii = _mm_cmpeq_epi32(high, _mm_setzero_si128());
+    if (_mm_movemask_epi8(ascii) != 0xFFFF)
+      return false;
+    if constexpr (write) {
+      __m128i ab = _mm_packs_epi32(a, b);
+      __m128i cd = _mm_packs_epi32(c, d);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                       _mm_packus_epi16(ab, cd));
+    }
+    return true;
+  } else {
+    __m128i a = load(0);
+    __m128i b = load(1);
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(~0x7F));
+    __m128i ascii = _mm_cmpeq_epi16(high, _mm_setzero_si128());
+    if (_mm_movemask_epi8(ascii) != 0xFFFF)
+      return false;
+    if constexpr (write) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                       _mm_packus_epi16(a, b));
+    }
+    return true;
+  }
+#else
+  // Branchless reduction, so that the compiler can vectorize it.
+  uint32_t any = 0;
+  for (ptrdiff_t i = 0; i < kBlock; ++i)
+    any |= uint32_t(input[i]);
+  if (any >= 0x80)
+    return false;
+  if constexpr (write) {
+    for (ptrdiff_t i = 0; i < kBlock; ++i)
+      output[i] = char(input[i]);
+  }
+  return true;
+#endif
+}
+
+// Read one code point from |it| and advance it. Surrogate pairs are joined.
+uint32_t NextCodePoint(const wchar_t*& it, const wchar_t* end) {
+  uint32_t c = uint32_t(*it++);
+  if (c < 0xD800)
+    return c;
+
+  // High surrogate:
+  if (c <= 0xDBFF) {
+    if (it == end)
+      return 0xFFFD;
+    uint32_t low = uint32_t(*it);
+    if (low < 0xDC00 || low > 0xDFFF)
+      return 0xFFFD;
+    ++it;
+    return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+  }
+
+  // Lone low surrogate:
+  if (c <= 0xDFFF)
+    return 0xFFFD;
+
+  if (c > 0x10FFFF)
+    return 0xFFFD;
+
+  return c;
+}
+
+size_t CodePointSize(uint32_t c) {
+  if (c < 0x80)
+    return 1;
+  if (c < 0x800)
+    return 2;
+  if (c < 0x10000)
+    return 3;
+  return 4;
+}
+
+char* EncodeCodePoint(uint32_t c, char* out) {
+  if (c < 0x80) {
+    *out++ = char(c);
+  } else if (c < 0x800) {
+    *out++ = char(0xC0 | (c >> 6));
+    *out++ = char(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    *out++ = char(0xE0 | (c >> 12));
+    *out++ = char(0x80 | ((c >> 6) & 0x3F));
+    *out++ = char(0x80 | (c & 0x3F));
+  } else {
+    *out++ = char(0xF0 | (c >> 18));
+    *out++ = char(0x80 | ((c >> 12) & 0x3F));
+    *out++ = char(0x80 | ((c >> 6) & 0x3F));
+    *out++ = char(0x80 | (c & 0x3F));
+  }
+  return out;
+}
+
+// Returns whether the |kBlock| bytes starting at |input| are all ASCII. When
+// they are, they are also widened into |output|.
+bool AsciiBlock(const char* input, wchar_t* output) {
+#if defined(DIAGON_UTF8_SSE2)
+  __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+  if (_mm_movemask_epi8(bytes))
+    return false;
+  __m128i zero = _mm_setzero_si128();
+  __m128i low = _mm_unpacklo_epi8(bytes, zero);
+  __m128i high = _mm_unpackhi_epi8(bytes, zero);
+  auto store = [&](int i, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output) + i, value);
+  };
+  if constexpr (sizeof(wchar_t) == 4) {
+    store(0, _mm_unpacklo_epi16(low, zero));
+    store(1, _mm_unpackhi_epi16(low, zero));
+    store(2, _mm_unpacklo_epi16(high, zero));
+    store(3, _mm_unpackhi_epi16(high, zero));
+  } else {
+    store(0, low);
+    store(1, high);
+  }
+  return true;
+#else
+  uint8_t any = 0;
+  for (ptrdiff_t i = 0; i < kBlock; ++i)
+    any |= uint8_t(input[i]);
+  if (any >= 0x80)
+    return false;
+  for (ptrdiff_t i = 0; i < kBlock; ++i)
+    output[i] = wchar_t(input[i]);
+  return true;
+#endif
+}
+
+// Read one code point from |it| and advance it. Malformed sequences are
+// consumed up to the first unexpected byte, and decoded as U+FFFD.
+uint32_t NextCodePoint(const char*& it, const char* end, bool* valid) {
+  uint32_t c = uint8_t(*it++);
+  if (c < 0x80)
+    return c;
+
+  int length;
+  uint32_t minimum;
+  if ((c & 0xE0) == 0xC0) {
+    length = 2;
+    minimum = 0x80;
+    c &= 0x1F;
+  } else if ((c & 0xF0) == 0xE0) {
+    length = 3;
+    minimum = 0x800;
+    c &= 0x0F;
+  } else if ((c & 0xF8) == 0xF0) {
+    length = 4;
+    minimum = 0x10000;
+    c &= 0x07;
+  } else {
+    *valid = false;
+    return 0xFFFD;
+  }
+
+  for (int i = 1; i < length; ++i) {
+    if (it == end || (uint8_t(*it) & 0xC0) != 0x80) {
+      *valid = false;
+      return 0xFFFD;
+    }
+    c = (c << 6) | (uint8_t(*it++) & 0x3F);
+  }
+
+  // Overlong encodings, surrogates and values out of range.
+  if (c < minimum || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+    *valid = false;
+    return 0xFFFD;
+  }
+  return c;
+}
+
+wchar_t* DecodeCodePoint(uint32_t c, wchar_t* out) {
+  if (c < 0x10000) {
+    *out++ = wchar_t(c);
+  } else {
+    c -= 0x10000;
+    *out++ = wchar_t(0xD800 + (c >> 10));
+    *out++ = wchar_t(0xDC00 + (c & 0x3FF));
+  }
+  return out;
+}
+
+}  // namespace
+
+size_t Utf8Size(std::wstring_view input) {
+  const wchar_t* it = input.data();
+  const wchar_t* end = it + input.size();
+  size_t size = 0;
+  while (end - it >= kBlock) {
+    if (AsciiBlock<false>(it, nullptr)) {
+      it += kBlock;
+      size += kBlock;
+      continue;
+    }
+
+    // Process the whole block with the scalar path before trying the fast path
+    // again. Box drawing characters usually come in runs.
+    const wchar_t* block_end = it + kBlock;
+    while (it < block_end)
+      size += CodePointSize(NextCodePoint(it, end));
+  }
+  while (it != end)
+    size += CodePointSize(NextCodePoint(it, end));
+  return size;
+}
+
+char* Utf8Encode(std::wstring_view input, char* output) {
+  const wchar_t* it = input.data();
+  const wchar_t* end = it + input.size();
+  while (end - it >= kBlock) {
+    if (AsciiBlock<true>(it, output)) {
+      it += kBlock;
+      output += kBlock;
+      continue;
+    }
+
+    const wchar_t* block_end = it + kBlock;
+    while (it < block_end)
+      output = EncodeCodePoint(NextCodePoint(it, end), output);
+  }
+  while (it != end)
+    output = EncodeCodePoint(NextCodePoint(it, end), output);
+  return output;
+}
+
+bool Utf8Decode(std::string_view input, std::wstring* output) {
+  // Every byte produces at most one wchar_t.
+  output->resize(input.size());
+  const char* it = input.data();
+  const char* end = it + input.size();
+  wchar_t* out = output->data();
+  bool valid = true;
+  while (end - it >= kBlock) {
+    if (AsciiBlock(it, out)) {
+      it += kBlock;
+      out += kBlock;
+      continue;
+    }
+
+    const char* block_end = it + kBlock;
+    while (it < block_end)
+      out = DecodeCodePoint(NextCodePoint(it, end, &valid), out);
+  }
+  while (it != end)
+    out = DecodeCodePoint(NextCodePoint(it, end, &valid), out);
+  output->resize(out - output->data());
+  return valid;
+}
@@ -0,0 +1,27 @@
+#ifndef SCREEN_UTF8_H
+#define SCREEN_UTF8_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// UTF-8 encoding and decoding of wide strings.
+//
+// Like std::codecvt_utf8_utf16, the decoder represents code points above
+// U+FFFF as UTF-16 surrogate pairs, whatever the size of wchar_t. The encoder
+// accepts both surrogate pairs and, when wchar_t is 32 bits, plain code points.
+// Invalid code points and malformed input are replaced by U+FFFD. None of
+// these functions throw.
+
+// Number of bytes needed to encode |input|.
+size_t Utf8Size(std::wstring_view input);
+
+// Encode |input| into |output|. |output| must have room for Utf8Size(input)
+// bytes. Returns the end of the written bytes.
+char* Utf8Encode(std::wstring_view input, char* output);
+
+// Decode |input| into |output|, replacing its content. The capacity of
+// |output| is reused. Returns false when |input| isn't valid UTF-8.
+bool Utf8Decode(std::string_view input, std::wstring* output);
+
+#endif /* end of include guard: SCREEN_UTF8_H */
@@ -0,0 +1,273 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+// Tests of the screen/ primitives the input/output tests can't reach through
+// the translators' inputs.
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "screen/Connection.h"
+#include "screen/LayeredScreen.h"
+#include "screen/Screen.h"
+#include "screen/Sink.h"
+
+namespace {
+
+int failures = 0;
+
+void Expect(const std::string& name,
+            const std::string& output,
+            const std::string& expected) {
+  if (output == expected)
+    return;
+  ++failures;
+  std::cout << "  [FAIL] " << name << std::endl;
+  std::cout << "---[Output]------------------" << std::endl;
+  std::cout << output << std::endl;
+  std::cout << "---[Expected]----------------" << std::endl;
+  std::cout << expected << std::endl;
+}
+
+Screen FromRows(const std::vector<std::wstring>& rows,
+                Screen::Storage storage = Screen::Storage::Wide) {
+  Screen screen(int(rows[0].size()), int(rows.size()), storage);
+  for (int y = 0; y < int(rows.size()); ++y)
+    screen.DrawText(0, y, rows[y]);
+  return screen;
+}
+
+std::string ToString(const std::vector<std::wstring>& rows) {
+  return FromRows(rows).ToString();
+}
+
+void TestDrawVerticalLineComplete() {
+  struct Case {
+    std::string name;
+    std::vector<std::wstring> before;
+    std::vector<std::wstring> after;
+  };
+  const std::vector<Case> cases = {
+      {"T junctions at the ends",
+       {L"───", L"   ", L"───"},
+       {L"─┬─", L" │ ", L"─┴─"}},
+      {"Corners at the ends",
+       {L"── ", L"   ", L" ──"},
+       {L"─┐ ", L" │ ", L" └─"}},
+      {"Corners at the ends, mirrored",
+       {L" ──", L"   ", L"── "},
+       {L" ┌─", L" │ ", L"─┘ "}},
+      {"Isolated line at an end",
+       {L" ─ ", L"   ", L"   "},
+       {L" ┼ ", L" │ ", L" │ "}},
+      {"Crossing", {L"   ", L"───", L"   "}, {L" │ ", L"─┼─", L" │ "}},
+      {"Crossing from one side",
+       {L"   ", L"── ", L"   "},
+       {L" │ ", L"─┤ ", L" │ "}},
+      {"Corners and T junctions are extended",
+       {L" ┐ ", L" ┘ ", L" ┬ "},
+       {L" ┤ ", L" ┤ ", L" ┼ "}},
+      {"Other cells are replaced",
+       {L" ┤ ", L" ┼ ", L" a "},
+       {L" │ ", L" │ ", L" │ "}},
+  };
+  for (const Case& test : cases) {
+    Screen screen = FromRows(test.before);
+    screen.DrawVerticalLineComplete(0, 2, 1);
+    Expect("DrawVerticalLineComplete: " + test.name, screen.ToString(),
+           ToString(test.after));
+  }
+}
+
+// The output of |screen|, through |ToString| and |Write|.
+std::string Output(Screen& screen) {
+  std::string output = screen.ToString();
+  for (bool trim_trailing_spaces : {false, true}) {
+    output += "---\n";
+    screen.Write(StringSink(&output).get(), trim_trailing_spaces);
+  }
+  return output;
+}
+
+struct StorageName {
+  Screen::Storage storage;
+  const char* name;
+};
+
+// The storages checked against |Screen::Storage::Wide|.
+const std::vector<StorageName> kStorages = {
+    {Screen::Storage::Compact, "Compact"},
+    {Screen::Storage::Sparse, "Sparse"},
+};
+
+// Draw with |draw| into a screen of every storage, and compare the outputs to
+// the one of the wide storage.
+void ExpectSameInStorages(
+    const std::string& name,
+    const std::function<Screen(Screen::Storage)>& draw) {
+  Screen wide = draw(Screen::Storage::Wide);
+  std::string expected = Output(wide);
+  for (const StorageName& storage : kStorages) {
+    Screen screen = draw(storage.storage);
+    Expect(name + " (" + storage.name + ")", Output(screen), expected);
+  }
+}
+
+// |count| distinct glyphs, starting at U+0100 and skipping the surrogates.
+std::wstring Glyphs(int count) {
+  std::wstring glyphs;
+  for (wchar_t c = 0x100; int(glyphs.size()) < count; ++c) {
+    if (c < 0xD800 || c > 0xDFFF)
+      glyphs += c;
+  }
+  return glyphs;
+}
+
+// Draw |glyphs| in rows of |width| cells.
+void DrawGlyphs(Screen* screen, const std::wstring& glyphs, int width) {
+  for (size_t i = 0; i < glyphs.size(); i += width)
+    screen->DrawText(0, int(i / width), glyphs.substr(i, width));
+}
+
+// Lines, junctions and text. |screen| must be at least 21x11.
+void DrawShapes(Screen* screen) {
+  screen->DrawBox(1, 1, 12, 5);
+  screen->DrawBoxedText(3, 2, L"Diagon");
+  screen->DrawHorizontalLine(0, 20, 8);
+  screen->DrawVerticalLineComplete(4, 10, 6);
+  screen->Connect(6, 1, kUp);
+  screen->FillRect(14, 2, 4, 3, L'#');
+  screen->DrawText(15, 10, L"é → ∀");
+}
+
+void TestStorages() {
+  ExpectSameInStorages("Shapes", [](Screen::Storage storage) {
+    Screen screen(24, 12, storage);
+    DrawShapes(&screen);
+    return screen;
+  });
+
+  for (int style = 0; style < 2; ++style) {
+    ExpectSameInStorages("ASCIIfy " + std::to_string(style),
+                         [style](Screen::Storage storage) {
+                           Screen screen(24, 12, storage);
+                           DrawShapes(&screen);
+                           screen.ASCIIfy(style);
+                           // Drawing after replacing the palette.
+                           screen.DrawBoxedText(12, 4, L"┼─┼");
+                           return screen;
+                         });
+  }
+
+  // The compact storage moves to 16 bits, and then to wide cells.
+  for (int count : {255, 256, 300, 65535, 65536, 70000}) {
+    ExpectSameInStorages(
+        std::to_string(count) + " glyphs", [count](Screen::Storage storage) {
+          Screen screen(300, std::max(12, count / 300 + 1), storage);
+          DrawGlyphs(&screen, Glyphs(count), 300);
+          DrawShapes(&screen);
+          return screen;
+        });
+  }
+
+  ExpectSameInStorages("Resize", [](Screen::Storage storage) {
+    Screen screen(24, 12, storage);
+    DrawShapes(&screen);
+    screen.Resize(30, 14);
+    screen.DrawBoxedText(20, 11, L"end");
+    screen.Resize(8, 3);
+    screen.Resize(12, 6);
+    return screen;
+  });
+
+  // Sparse screens leave most of their tiles blank, and write blank rows
+  // without decoding them.
+  ExpectSameInStorages("Mostly blank", [](Screen::Storage storage) {
+    Screen screen(500, 200, storage);
+    DrawShapes(&screen);
+    screen.DrawBoxedText(430, 150, L"far");
+    screen.FillRect(100, 20, 300, 100, L' ');
+    screen.FillRect(200, 60, 70, 20, L'.');
+    screen.FillRect(210, 65, 10, 5, L' ');
+    screen.DrawVerticalLineComplete(0, 199, 499);
+    return screen;
+  });
+
+  // Copies share their tiles until they are drawn into.
+  ExpectSameInStorages("Copy drawn into", [](Screen::Storage storage) {
+    Screen screen(200, 50, storage);
+    DrawShapes(&screen);
+    Screen copy = screen;
+    copy.DrawBoxedText(2, 3, L"copy");
+    copy.DrawBoxedText(150, 40, L"copy");
+    return copy;
+  });
+  ExpectSameInStorages("Copy not drawn into", [](Screen::Storage storage) {
+    Screen screen(200, 50, storage);
+    DrawShapes(&screen);
+    Screen copy = screen;
+    copy.DrawBoxedText(2, 3, L"copy");
+    copy.DrawBoxedText(150, 40, L"copy");
+    copy.FillRect(0, 0, 200, 50, L' ');
+    return screen;
+  });
+
+  // |Append| across storages, in both directions.
+  for (const StorageName& other : kStorages) {
+    ExpectSameInStorages(
+        std::string("Append ") + other.name,
+        [&other](Screen::Storage storage) {
+          Screen screen(24, 12, storage);
+          DrawShapes(&screen);
+          Screen appended(300, 2, other.storage);
+          DrawGlyphs(&appended, Glyphs(600), 300);
+          screen.Append(appended, 5, 3);
+          return screen;
+        });
+    ExpectSameInStorages(std::string("Append to ") + other.name,
+                         [&other](Screen::Storage storage) {
+                           Screen screen(24, 12, other.storage);
+                           DrawShapes(&screen);
+                           Screen appended(10, 4, storage);
+                           appended.DrawBoxedText(0, 0, L"┼→");
+                           screen.Append(appended, 20, 10);
+                           return screen;
+                         });
+  }
+}
+
+// Rendering in parallel bands gives the same result as rendering on one
+// thread, in every storage.
+void TestLayeredScreen() {
+  LayeredScreen canvas(150, 300);
+  for (int y = 0; y < 290; y += 7) {
+    canvas.Layer(0).DrawBox(y % 50, y, 60, 5);
+    canvas.Layer(0).DrawText(y % 50 + 2, y + 2, L"Node " + std::to_wstring(y));
+    canvas.Layer(1).DrawVerticalLine(0, 299, y % 140);
+    canvas.Layer(1).DrawHorizontalLine(0, 149, y + 3);
+  }
+  for (int threads : {1, 3, 0}) {
+    ExpectSameInStorages(
+        "LayeredScreen " + std::to_string(threads) + " threads",
+        [&canvas, threads](Screen::Storage storage) {
+          return canvas.Render(storage, threads);
+        });
+  }
+  Screen wide = canvas.Render();
+  Screen parallel = canvas.Render(Screen::Storage::Wide, 4);
+  Expect("LayeredScreen parallel", Output(parallel), Output(wide));
+}
+
+}  // namespace
+
+int main(int, const char**) {
+  TestDrawVerticalLineComplete();
+  TestStorages();
+  TestLayeredScreen();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
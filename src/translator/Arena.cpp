@@ -0,0 +1,45 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "translator/Arena.h"
+
+#include "translator/Budget.h"
+
+namespace {
+
+thread_local std::pmr::memory_resource* g_memory = nullptr;
+
+}  // namespace
+
+void* TranslationArena::CappedResource::do_allocate(size_t bytes,
+                                                    size_t alignment) {
+  if (bytes > max_bytes_ - allocated_bytes_)
+    throw BudgetExceeded(BudgetExceeded::Memory);
+  void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  allocated_bytes_ += bytes;
+  return p;
+}
+
+void TranslationArena::CappedResource::do_deallocate(void* p,
+                                                     size_t bytes,
+                                                     size_t alignment) {
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  allocated_bytes_ -= bytes;
+}
+
+TranslationArena::TranslationArena(size_t max_bytes)
+    : capped_(max_bytes), monotonic_(&capped_), pool_(&monotonic_) {}
+
+ScopedTranslationArena::ScopedTranslationArena(TranslationArena* arena)
+    : previous_(g_memory) {
+  g_memory = arena->resource();
+}
+
+ScopedTranslationArena::~ScopedTranslationArena() {
+  g_memory = previous_;
+}
+
+std::pmr::memory_resource* TranslationMemory() {
+  return g_memory ? g_memory : std::pmr::get_default_resource();
+}
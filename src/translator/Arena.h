@@ -0,0 +1,70 @@
+#ifndef TRANSLATOR_ARENA
+#define TRANSLATOR_ARENA
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+
+// Memory for the data structures of the translations run by a thread, while a
+// |ScopedTranslationArena| is in scope. Nothing is returned to the heap before
+// the arena is destroyed, where everything is released at once.
+//
+// When more than |max_bytes| are requested from the heap, the allocation
+// throws |BudgetExceeded| with the |Memory| reason.
+//
+// Opt-in: without an arena, translators allocate from the default resource.
+class TranslationArena {
+ public:
+  explicit TranslationArena(
+      size_t max_bytes = std::numeric_limits<size_t>::max());
+  TranslationArena(const TranslationArena&) = delete;
+  TranslationArena& operator=(const TranslationArena&) = delete;
+
+  std::pmr::memory_resource* resource() { return &pool_; }
+  // The bytes requested from the heap so far.
+  size_t allocated_bytes() const { return capped_.allocated_bytes(); }
+
+ private:
+  // Counts and caps the allocations from the heap.
+  class CappedResource : public std::pmr::memory_resource {
+   public:
+    explicit CappedResource(size_t max_bytes) : max_bytes_(max_bytes) {}
+    size_t allocated_bytes() const { return allocated_bytes_; }
+
+   private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+    size_t max_bytes_;
+    size_t allocated_bytes_ = 0;
+  };
+
+  CappedResource capped_;
+  // Hands out large blocks, freed at destruction only.
+  std::pmr::monotonic_buffer_resource monotonic_;
+  // Recycles the blocks freed during the translation, like the graphs that
+  // are rebuilt several times.
+  std::pmr::unsynchronized_pool_resource pool_;
+};
+
+// Makes the translations run by the current thread allocate from |arena|,
+// while in scope. Scopes can be nested.
+class ScopedTranslationArena {
+ public:
+  explicit ScopedTranslationArena(TranslationArena* arena);
+  ~ScopedTranslationArena();
+  ScopedTranslationArena(const ScopedTranslationArena&) = delete;
+  ScopedTranslationArena& operator=(const ScopedTranslationArena&) = delete;
+
+ private:
+  std::pmr::memory_resource* previous_;
+};
+
+// The memory resource the current translation allocates from: the arena of
+// the current thread, or the default resource.
+std::pmr::memory_resource* TranslationMemory();
+
+#endif /* end of include guard: TRANSLATOR_ARENA */
@@ -0,0 +1,58 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "translator/Budget.h"
+
+namespace {
+
+constexpr uint64_t kStepsBetweenChecks = 4096;
+
+thread_local TranslationBudget* g_budget = nullptr;
+
+const char* Message(BudgetExceeded::Reason reason) {
+  switch (reason) {
+    case BudgetExceeded::Cancelled:
+      return "Translation cancelled";
+    case BudgetExceeded::Deadline:
+      return "Translation deadline exceeded";
+    case BudgetExceeded::Steps:
+      return "Translation step budget exceeded";
+    case BudgetExceeded::Memory:
+      return "Translation memory budget exceeded";
+  }
+  // NOTREACHED
+  return "Translation budget exceeded";
+}
+
+}  // namespace
+
+BudgetExceeded::BudgetExceeded(Reason reason)
+    : std::runtime_error(Message(reason)), reason_(reason) {}
+
+void TranslationBudget::Step(uint64_t steps) {
+  steps_ += steps;
+  if (steps_ > max_steps_)
+    throw BudgetExceeded(BudgetExceeded::Steps);
+  if (steps_ < next_check_)
+    return;
+  next_check_ = steps_ + kStepsBetweenChecks;
+  if (cancelled_)
+    throw BudgetExceeded(BudgetExceeded::Cancelled);
+  if (Clock::now() > deadline_)
+    throw BudgetExceeded(BudgetExceeded::Deadline);
+}
+
+ScopedTranslationBudget::ScopedTranslationBudget(TranslationBudget* budget)
+    : previous_(g_budget) {
+  g_budget = budget;
+}
+
+ScopedTranslationBudget::~ScopedTranslationBudget() {
+  g_budget = previous_;
+}
+
+void BudgetStep(uint64_t steps) {
+  if (g_budget)
+    g_budget->Step(steps);
+}
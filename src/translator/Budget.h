@@ -0,0 +1,86 @@
+#ifndef TRANSLATOR_BUDGET
+#define TRANSLATOR_BUDGET
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+// Limits the work of a translation: it can be cancelled from another thread,
+// given a deadline, and given a number of steps. The layout loops count their
+// steps with |BudgetStep|, which throws |BudgetExceeded| once the budget is
+// exhausted.
+//
+// Usage:
+//   TranslationBudget budget;
+//   budget.set_timeout(std::chrono::milliseconds(200));
+//   ScopedTranslationBudget scoped_budget(&budget);
+//   try {
+//     output = translator->Translate(input, options);
+//   } catch (const BudgetExceeded& error) {
+//     ...
+//   }
+class TranslationBudget {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void set_deadline(Clock::time_point deadline) { deadline_ = deadline; }
+  void set_timeout(Clock::duration timeout) {
+    deadline_ = Clock::now() + timeout;
+  }
+  void set_max_steps(uint64_t max_steps) { max_steps_ = max_steps; }
+
+  // Can be called from any thread.
+  void Cancel() { cancelled_ = true; }
+  bool cancelled() const { return cancelled_; }
+
+  // The steps counted so far.
+  uint64_t steps() const { return steps_; }
+
+ private:
+  friend void BudgetStep(uint64_t steps);
+  void Step(uint64_t steps);
+
+  std::atomic<bool> cancelled_{false};
+  Clock::time_point deadline_ = Clock::time_point::max();
+  uint64_t max_steps_ = std::numeric_limits<uint64_t>::max();
+  uint64_t steps_ = 0;
+  uint64_t next_check_ = 0;
+};
+
+// Thrown by |BudgetStep| when the translation must stop.
+class BudgetExceeded : public std::runtime_error {
+ public:
+  enum Reason {
+    Cancelled,
+    Deadline,
+    Steps,
+    Memory,  // See |TranslationArena|.
+  };
+  explicit BudgetExceeded(Reason reason);
+  Reason reason() const { return reason_; }
+
+ private:
+  Reason reason_;
+};
+
+// Applies |budget| to the translations run by the current thread, while in
+// scope. Scopes can be nested.
+class ScopedTranslationBudget {
+ public:
+  explicit ScopedTranslationBudget(TranslationBudget* budget);
+  ~ScopedTranslationBudget();
+  ScopedTranslationBudget(const ScopedTranslationBudget&) = delete;
+  ScopedTranslationBudget& operator=(const ScopedTranslationBudget&) = delete;
+
+ private:
+  TranslationBudget* previous_;
+};
+
+// Counts |steps| units of work against the budget of the current thread, if
+// any. Throws |BudgetExceeded| when it is exhausted. The cancellation flag and
+// the clock are only checked every few thousand steps.
+void BudgetStep(uint64_t steps = 1);
+
+#endif /* end of include guard: TRANSLATOR_BUDGET */
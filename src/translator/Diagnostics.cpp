@@ -0,0 +1,38 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "translator/Diagnostics.h"
+
+#include <utility>
+
+namespace {
+
+thread_local std::vector<Diagnostic>* g_diagnostics = nullptr;
+
+}  // namespace
+
+ScopedDiagnostics::ScopedDiagnostics(std::vector<Diagnostic>* diagnostics)
+    : previous_(g_diagnostics) {
+  g_diagnostics = diagnostics;
+}
+
+ScopedDiagnostics::~ScopedDiagnostics() {
+  g_diagnostics = previous_;
+}
+
+bool DiagnosticsEnabled() {
+  return g_diagnostics;
+}
+
+void ReportDiagnostic(Diagnostic diagnostic) {
+  if (g_diagnostics)
+    g_diagnostics->push_back(std::move(diagnostic));
+}
+
+std::string ToString(const Diagnostic& diagnostic) {
+  if (diagnostic.line == 0)
+    return diagnostic.message;
+  return std::to_string(diagnostic.line) + ":" +
+         std::to_string(diagnostic.column) + ": " + diagnostic.message;
+}
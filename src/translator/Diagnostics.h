@@ -0,0 +1,56 @@
+#ifndef TRANSLATOR_DIAGNOSTICS
+#define TRANSLATOR_DIAGNOSTICS
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A problem found in the input of a translation, e.g. an ignored command. The
+// translation still produces an output.
+struct Diagnostic {
+  // Identifies the kind of problem, e.g. "sequence-self-message".
+  std::string code;
+  // The position in the input, starting at 1. 0 when unknown.
+  size_t line = 0;
+  size_t column = 0;
+  std::string message;
+};
+
+// The output of a translation, with the diagnostics found in its input.
+struct TranslationResult {
+  std::string output;
+  std::vector<Diagnostic> diagnostics;
+};
+
+// Appends the diagnostics of the translations run by the current thread to
+// |diagnostics|, while in scope. Scopes can be nested.
+//
+// Usage:
+//   std::vector<Diagnostic> diagnostics;
+//   ScopedDiagnostics scoped_diagnostics(&diagnostics);
+//   output = translator->Translate(input, options);
+//
+// Opt-in: without a scope, the diagnostics are dropped. Translators never
+// write them to the standard streams.
+class ScopedDiagnostics {
+ public:
+  explicit ScopedDiagnostics(std::vector<Diagnostic>* diagnostics);
+  ~ScopedDiagnostics();
+  ScopedDiagnostics(const ScopedDiagnostics&) = delete;
+  ScopedDiagnostics& operator=(const ScopedDiagnostics&) = delete;
+
+ private:
+  std::vector<Diagnostic>* previous_;
+};
+
+// Whether the diagnostics of the current thread are collected. Translators can
+// check it to avoid formatting messages nobody reads.
+bool DiagnosticsEnabled();
+
+// Reports |diagnostic| to the scope of the current thread, if any.
+void ReportDiagnostic(Diagnostic diagnostic);
+
+// "line:column: message", or "message" when the position is unknown.
+std::string ToString(const Diagnostic& diagnostic);
+
+#endif /* end of include guard: TRANSLATOR_DIAGNOSTICS */
@@ -0,0 +1,150 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "translator/DiskCache.h"
+
+#include "filesystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Suffix of the files being written. They are ignored by |Get|, and removed by
+// |CollectGarbage| once they are old enough to be leftovers of a killed
+// process.
+const char kTemporarySuffix[] = ".tmp";
+
+}  // namespace
+
+DiskCache::DiskCache(std::string directory, uintmax_t max_bytes)
+    : directory_(std::move(directory)), max_bytes_(max_bytes) {}
+
+// Entries are spread over 256 subdirectories, like git objects, to keep the
+// directories small.
+std::string DiskCache::Path(const ContentHash& hash) const {
+  std::string name = hash.ToString();
+  return (fs::path(directory_) / name.substr(0, 2) / name.substr(2)).string();
+}
+
+bool DiskCache::Get(const ContentHash& hash, std::string* output) const {
+  std::string path = Path(hash);
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  std::stringstream ss;
+  ss << file.rdbuf();
+  if (file.bad())
+    return false;
+  *output = ss.str();
+
+  // Mark the entry as recently used.
+  std::error_code error;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+  return true;
+}
+
+void DiskCache::Put(const ContentHash& hash, std::string_view output) const {
+  fs::path path = Path(hash);
+  std::error_code error;
+  fs::create_directories(path.parent_path(), error);
+  if (error)
+    return;
+
+  // A name no other process writes to.
+  std::random_device random;
+  fs::path temporary = path;
+  temporary += "." + std::to_string(random()) + kTemporarySuffix;
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(output.data(), output.size());
+    file.close();
+    if (!file) {
+      fs::remove(temporary, error);
+      return;
+    }
+  }
+
+  fs::rename(temporary, path, error);
+  if (error) {
+    fs::remove(temporary, error);
+    return;
+  }
+
+  if (EstimateSize(hash) > max_bytes_)
+    CollectGarbage();
+}
+
+// The hashes spread the entries evenly over the 256 subdirectories. The size of
+// the one of |hash| is extrapolated, instead of listing the whole directory on
+// every |Put|.
+uintmax_t DiskCache::EstimateSize(const ContentHash& hash) const {
+  fs::path directory = fs::path(Path(hash)).parent_path();
+  uintmax_t size = 0;
+  std::error_code error;
+  for (fs::directory_iterator it(directory, error), end; !error && it != end;
+       it.increment(error)) {
+    std::error_code file_error;
+    uintmax_t file_size = it->file_size(file_error);
+    if (!file_error)
+      size += file_size;
+  }
+  return size * 256;
+}
+
+void DiskCache::CollectGarbage() const {
+  struct File {
+    fs::path path;
+    fs::file_time_type time;
+    uintmax_t size;
+  };
+  std::vector<File> files;
+  uintmax_t total = 0;
+
+  const auto now = fs::file_time_type::clock::now();
+  std::error_code error;
+  for (fs::recursive_directory_iterator it(directory_, error), end;
+       !error && it != end; it.increment(error)) {
+    std::error_code file_error;
+    if (!it->is_regular_file(file_error))
+      continue;
+    File file;
+    file.path = it->path();
+    file.time = fs::last_write_time(file.path, file_error);
+    file.size = fs::file_size(file.path, file_error);
+    if (file_error)
+      continue;
+
+    if (file.path.extension() == kTemporarySuffix) {
+      if (now - file.time > std::chrono::hours(1))
+        fs::remove(file.path, file_error);
+      continue;
+    }
+
+    total += file.size;
+    files.push_back(std::move(file));
+  }
+
+  if (total <= max_bytes_)
+    return;
+
+  const uintmax_t target = max_bytes_ / 4 * 3;
+  std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+    return a.time < b.time;
+  });
+  for (const File& file : files) {
+    if (total <= target)
+      break;
+    if (fs::remove(file.path, error))
+      total -= file.size;
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef TRANSLATOR_DISK_CACHE
+#define TRANSLATOR_DISK_CACHE
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "translator/TranslationCache.h"
+
+// A directory of translation outputs, each stored in a file named after the
+// hash of what produced it. It can be shared by concurrent processes.
+//
+// Entries are written to a temporary file and then renamed, so a reader never
+// sees a partial entry. Reads refresh the modification time of the entry.
+// Once the directory exceeds |max_bytes|, |CollectGarbage| removes the least
+// recently used entries until it fits in 3/4 of |max_bytes|, so that it isn't
+// needed again for a while.
+//
+// Errors are never reported: a cache that can't be read or written behaves
+// like an empty one.
+class DiskCache {
+ public:
+  DiskCache(std::string directory, uintmax_t max_bytes);
+
+  bool Get(const ContentHash& hash, std::string* output) const;
+  // Stores |output|, and collects the garbage when the directory is estimated
+  // to exceed |max_bytes|.
+  void Put(const ContentHash& hash, std::string_view output) const;
+  // Lists the whole directory. Prefer letting |Put| call it when needed.
+  void CollectGarbage() const;
+
+ private:
+  std::string Path(const ContentHash& hash) const;
+  uintmax_t EstimateSize(const ContentHash& hash) const;
+
+  std::string directory_;
+  uintmax_t max_bytes_;
+};
+
+#endif /* end of include guard: TRANSLATOR_DISK_CACHE */
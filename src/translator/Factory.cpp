@@ -1,5 +1,8 @@
 #include "translator/Factory.h"
-#include <algorithm>
+
+#include <array>
+#include <iterator>
+#include <mutex>
 
 // List of exported translator.
 TranslatorPtr FrameTranslator();
@@ -12,32 +15,101 @@ TranslatorPtr TableTranslator();
 TranslatorPtr TreeTranslator();
 TranslatorPtr FlowchartTranslator();
 
-std::vector<TranslatorPtr>& TranslatorList() {
-  static std::vector<TranslatorPtr> out;
-  if (out.size() != 0)
-    return out;
+namespace {
 
-  out.push_back(MathTranslator());
-  out.push_back(SequenceTranslator());
-  out.push_back(TreeTranslator());
-  out.push_back(TableTranslator());
-  out.push_back(GrammarTranslator());
-  out.push_back(FrameTranslator());
-  out.push_back(GraphDAGTranslator());
-  out.push_back(GraphPlanarTranslator());
-  out.push_back(FlowchartTranslator());
+struct Entry {
+  std::string_view identifier;
+  TranslatorPtr (*make)();
+};
 
-  auto is_null = [](const TranslatorPtr& t) { return t == nullptr; };
-  out.erase(std::remove_if(out.begin(), out.end(), is_null), out.end());
+// In the order of |TranslatorList|.
+constexpr Entry kEntries[] = {
+    {"Math", MathTranslator},
+    {"Sequence", SequenceTranslator},
+    {"Tree", TreeTranslator},
+    {"Table", TableTranslator},
+    {"Grammar", GrammarTranslator},
+    {"Frame", FrameTranslator},
+    {"GraphDAG", GraphDAGTranslator},
+    {"GraphPlanar", GraphPlanarTranslator},
+    {"Flowchart", FlowchartTranslator},
+};
+constexpr int kEntryCount = std::size(kEntries);
 
-  return out;
+// A perfect hash of the identifiers above: each of them gets its own slot.
+constexpr int kSlotCount = 16;
+constexpr int Hash(std::string_view name) {
+  if (name.empty())
+    return 0;
+  return (name.size() + 2 * name.front() + 6 * name.back()) % kSlotCount;
+}
+
+// |kEntries| index for each slot, or -1.
+constexpr std::array<int, kSlotCount> BuildSlots() {
+  std::array<int, kSlotCount> slots = {};
+  for (int& slot : slots)
+    slot = -1;
+  for (int i = 0; i < kEntryCount; ++i) {
+    int& slot = slots[Hash(kEntries[i].identifier)];
+    if (slot != -1)
+      return {};  // Collision. Rejected by the static_assert below.
+    slot = i;
+  }
+  return slots;
 }
+constexpr std::array<int, kSlotCount> kSlots = BuildSlots();
 
-Translator* FindTranslator(const std::string& name) {
-  auto& list = TranslatorList();
-  for (auto& it : list) {
-    if (it->Identifier() == name)
-      return it.get();
+constexpr bool IsPerfect() {
+  for (int i = 0; i < kEntryCount; ++i) {
+    if (kSlots[Hash(kEntries[i].identifier)] != i)
+      return false;
   }
-  return nullptr;
+  return true;
+}
+static_assert(IsPerfect(), "Translator identifiers collide, update |Hash|.");
+
+int Find(std::string_view name) {
+  int index = kSlots[Hash(name)];
+  if (index == -1 || kEntries[index].identifier != name)
+    return -1;
+  return index;
+}
+
+// The shared instances, constructed on first use. Safe to use from several
+// threads at once.
+Translator* Instance(int index) {
+  static std::once_flag flags[kEntryCount];
+  static TranslatorPtr instances[kEntryCount];
+  std::call_once(flags[index],
+                 [&] { instances[index] = kEntries[index].make(); });
+  return instances[index].get();
+}
+
+}  // namespace
+
+const std::vector<Translator*>& TranslatorList() {
+  // Built once, even when called from several threads at once.
+  static const std::vector<Translator*> out = [] {
+    std::vector<Translator*> out;
+    for (int i = 0; i < kEntryCount; ++i) {
+      if (Translator* translator = Instance(i))
+        out.push_back(translator);
+    }
+    return out;
+  }();
+  return out;
+}
+
+Translator* FindTranslator(std::string_view name) {
+  int index = Find(name);
+  return index == -1 ? nullptr : Instance(index);
+}
+
+bool HasTranslator(std::string_view name) {
+  return Find(name) != -1;
+}
+
+TranslatorPtr MakeTranslator(std::string_view name) {
+  int index = Find(name);
+  return index == -1 ? nullptr : kEntries[index].make();
 }
@@ -1,13 +1,25 @@
 #ifndef TRANSLATOR_TRANSLATOR_FACTORY
 #define TRANSLATOR_TRANSLATOR_FACTORY
 
-#include <vector>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "translator/Translator.h"
 
 using TranslatorPtr = std::unique_ptr<Translator>;
 
-std::vector<TranslatorPtr>& TranslatorList();
-Translator* FindTranslator(const std::string& name);
+// Every available translator. Constructs all of them on first use.
+const std::vector<Translator*>& TranslatorList();
+
+// The shared translator named |name|, constructed on first use. Only this one
+// is constructed. Returns nullptr when it doesn't exist.
+Translator* FindTranslator(std::string_view name);
+
+// Whether |name| identifies a translator. Doesn't construct it.
+bool HasTranslator(std::string_view name);
+
+// A new instance of the translator named |name|, or nullptr.
+TranslatorPtr MakeTranslator(std::string_view name);
 
 #endif /* end of include guard: TRANSLATOR_TRANSLATOR_FACTORY */
@@ -0,0 +1,214 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "translator/TranslationCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "translator/Translator.h"
+
+namespace {
+
+uint64_t Rotate(uint64_t x, int bits) {
+  return (x << bits) | (x >> (64 - bits));
+}
+
+// The finalizer of MurmurHash3: every input bit affects every output bit.
+uint64_t Avalanche(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccd;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53;
+  x ^= x >> 33;
+  return x;
+}
+
+// Two independent lanes, consuming 8 bytes at a time.
+class Hasher {
+ public:
+  void Update(uint64_t word) {
+    low_ = Rotate((low_ ^ word) * 0x9e3779b97f4a7c15, 29);
+    high_ = Rotate((high_ + word) * 0xc2b2ae3d27d4eb4f, 31) ^ low_;
+    ++words_;
+  }
+
+  void Update(std::string_view data) {
+    Update(uint64_t(data.size()));
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+      uint64_t word;
+      std::memcpy(&word, data.data() + i, 8);
+      Update(word);
+    }
+    if (i < data.size()) {
+      uint64_t word = 0;
+      std::memcpy(&word, data.data() + i, data.size() - i);
+      Update(word);
+    }
+  }
+
+  ContentHash Finish() const {
+    ContentHash hash;
+    hash.high = Avalanche(high_ ^ words_);
+    hash.low = Avalanche(low_ ^ hash.high);
+    return hash;
+  }
+
+ private:
+  uint64_t low_ = 0x243f6a8885a308d3;
+  uint64_t high_ = 0x13198a2e03707344;
+  uint64_t words_ = 0;
+};
+
+struct ContentHashHasher {
+  size_t operator()(const ContentHash& hash) const { return size_t(hash.low); }
+};
+
+}  // namespace
+
+std::string ContentHash::ToString() const {
+  static const char digits[] = "0123456789abcdef";
+  std::string out(32, '0');
+  for (int i = 0; i < 16; ++i) {
+    out[15 - i] = digits[(high >> (4 * i)) & 0xF];
+    out[31 - i] = digits[(low >> (4 * i)) & 0xF];
+  }
+  return out;
+}
+
+ContentHash HashContent(const std::vector<std::string_view>& parts) {
+  Hasher hasher;
+  for (std::string_view part : parts)
+    hasher.Update(part);
+  return hasher.Finish();
+}
+
+struct TranslationCache::Shard {
+  struct Entry {
+    ContentHash hash;
+    // What was hashed, to tell apart the translations whose hashes collide.
+    std::string identifier;
+    std::string options;
+    std::string input;
+    std::string output;
+    size_t bytes = 0;
+  };
+
+  std::mutex mutex;
+  std::list<Entry> entries;  // The most recently used first.
+  std::unordered_map<ContentHash, std::list<Entry>::iterator, ContentHashHasher>
+      index;
+  TranslationCacheStats stats;
+};
+
+TranslationCache::TranslationCache(size_t max_bytes, int shards) {
+  shards = std::max(shards, 1);
+  for (int i = 0; i < shards; ++i)
+    shards_.push_back(std::make_unique<Shard>());
+  max_bytes_per_shard_ = max_bytes / shards;
+}
+
+TranslationCache::~TranslationCache() = default;
+
+TranslationCache::Shard& TranslationCache::ShardFor(const ContentHash& hash) {
+  return *shards_[hash.high % shards_.size()];
+}
+
+std::string TranslationCache::Translate(Translator* translator,
+                                        const std::string& input,
+                                        const std::string& options) {
+  return Translate(translator, input, translator->CompileOptions(options));
+}
+
+std::string TranslationCache::Translate(Translator* translator,
+                                        const std::string& input,
+                                        const OptionSet& options) {
+  std::string identifier = translator->Identifier();
+  std::string normalized_options = options.Serialize();
+  ContentHash hash = HashContent({identifier, normalized_options, input});
+  Shard& shard = ShardFor(hash);
+
+  auto matches = [&](const Shard::Entry& entry) {
+    return entry.identifier == identifier &&
+           entry.options == normalized_options && entry.input == input;
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(hash);
+    if (it != shard.index.end() && matches(*it->second)) {
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      shard.stats.hits++;
+      return it->second->output;
+    }
+    shard.stats.misses++;
+  }
+
+  // Translate without holding the lock. Concurrent misses on the same key all
+  // translate, the last one to finish is kept.
+  std::string output = translator->Translate(input, options);
+
+  Shard::Entry entry;
+  entry.hash = hash;
+  entry.identifier = std::move(identifier);
+  entry.options = std::move(normalized_options);
+  entry.input = input;
+  entry.output = output;
+  entry.bytes = sizeof(Shard::Entry) + entry.identifier.size() +
+                entry.options.size() + entry.input.size() +
+                entry.output.size();
+  if (entry.bytes > max_bytes_per_shard_)
+    return output;
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(hash);
+  if (it != shard.index.end()) {
+    shard.stats.bytes -= it->second->bytes;
+    shard.stats.entries--;
+    shard.entries.erase(it->second);
+    shard.index.erase(it);
+  }
+
+  shard.stats.bytes += entry.bytes;
+  shard.stats.entries++;
+  shard.entries.push_front(std::move(entry));
+  shard.index[hash] = shard.entries.begin();
+
+  while (shard.stats.bytes > max_bytes_per_shard_) {
+    Shard::Entry& last = shard.entries.back();
+    shard.stats.bytes -= last.bytes;
+    shard.stats.entries--;
+    shard.stats.evictions++;
+    shard.index.erase(last.hash);
+    shard.entries.pop_back();
+  }
+  return output;
+}
+
+TranslationCacheStats TranslationCache::stats() const {
+  TranslationCacheStats out;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    out.hits += shard->stats.hits;
+    out.misses += shard->stats.misses;
+    out.evictions += shard->stats.evictions;
+    out.entries += shard->stats.entries;
+    out.bytes += shard->stats.bytes;
+  }
+  return out;
+}
+
+void TranslationCache::Clear() {
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->entries.clear();
+    shard->index.clear();
+    shard->stats.entries = 0;
+    shard->stats.bytes = 0;
+  }
+}
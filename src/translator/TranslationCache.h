@@ -0,0 +1,72 @@
+#ifndef TRANSLATOR_TRANSLATION_CACHE
+#define TRANSLATOR_TRANSLATION_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class OptionSet;
+class Translator;
+
+// A 128 bits hash of some content.
+struct ContentHash {
+  uint64_t high = 0;
+  uint64_t low = 0;
+
+  bool operator==(const ContentHash& other) const {
+    return high == other.high && low == other.low;
+  }
+  // The 32 hexadecimal digits.
+  std::string ToString() const;
+};
+
+// Hashes the concatenation of |parts|, each of them prefixed by its size, so
+// that {"ab", "c"} and {"a", "bc"} differ.
+ContentHash HashContent(const std::vector<std::string_view>& parts);
+
+// Counters of a |TranslationCache|.
+struct TranslationCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  // The entries held, and their size: input, options and output.
+  size_t entries = 0;
+  size_t bytes = 0;
+};
+
+// Stores the output of translations, keyed by the translator, its normalized
+// options and the input, so that a repeated translation is served without
+// running the translator again.
+//
+// Thread safe. The entries are spread over |shards| by hash, each with its own
+// lock and its own least recently used list, bounded to its share of
+// |max_bytes|.
+class TranslationCache {
+ public:
+  explicit TranslationCache(size_t max_bytes, int shards = 16);
+  ~TranslationCache();
+
+  // Same as |translator->Translate(input, options)|, served from the cache
+  // when possible. Translations throwing an exception are not cached.
+  std::string Translate(Translator* translator,
+                        const std::string& input,
+                        const OptionSet& options);
+  std::string Translate(Translator* translator,
+                        const std::string& input,
+                        const std::string& options);
+
+  TranslationCacheStats stats() const;
+  void Clear();
+
+ private:
+  struct Shard;
+  Shard& ShardFor(const ContentHash& hash);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t max_bytes_per_shard_;
+};
+
+#endif /* end of include guard: TRANSLATOR_TRANSLATION_CACHE */
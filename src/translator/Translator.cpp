@@ -4,16 +4,253 @@
 
 #include "translator/Translator.h"
 
-#include <sstream>
+#include <algorithm>
+#include <map>
 #include <string>
 
-// static
-std::map<std::string, std::string> SerializeOption(const std::string& options) {
-  std::map<std::string, std::string> m;
-  std::stringstream ss(options);
-  std::string label, value;
-  while (std::getline(ss, label) && std::getline(ss, value)) {
-    m[label] = value;
+#include "screen/Sink.h"
+
+namespace {
+
+// Keep the layout of the input until it is edited.
+class LayoutSession : public TranslationSession {
+ public:
+  LayoutSession(const Translator* translator,
+                std::string input,
+                const OptionSet& options)
+      : TranslationSession(std::move(input)),
+        translator_(translator),
+        options_(options) {}
+
+  void RenderTo(Sink* sink) override {
+    if (!layout_) {
+      diagnostics_.clear();
+      ScopedDiagnostics scoped_diagnostics(&diagnostics_);
+      layout_ = translator_->ComputeLayout(input_, options_);
+    }
+
+    // The diagnostics found while laying the input out are reported on every
+    // render.
+    for (const Diagnostic& diagnostic : diagnostics_)
+      ReportDiagnostic(diagnostic);
+
+    // Translators without layouts translate the input every time.
+    if (!layout_) {
+      translator_->TranslateTo(input_, options_, sink);
+      return;
+    }
+    layout_->Rasterize(options_, sink);
+  }
+
+ private:
+  void OnEdit(size_t offset, size_t removed, size_t inserted) override {
+    layout_.reset();
+  }
+
+  const Translator* translator_;
+  OptionSet options_;
+  std::unique_ptr<TranslationLayout> layout_;
+  std::vector<Diagnostic> diagnostics_;
+};
+
+}  // namespace
+
+void Translator::TranslateTo(const std::string& input,
+                             const OptionSet& options,
+                             Sink* sink) const {
+  sink->Write(Translate(input, options));
+}
+
+std::string Translator::Translate(const std::string& input,
+                                  const std::string& options) const {
+  return Translate(input, CompileOptions(options));
+}
+
+void Translator::TranslateTo(const std::string& input,
+                             const std::string& options,
+                             Sink* sink) const {
+  TranslateTo(input, CompileOptions(options), sink);
+}
+
+OptionSet Translator::CompileOptions(const std::string& options) const {
+  return OptionSet(Options(), options);
+}
+
+TranslationResult Translator::TranslateWithDiagnostics(
+    const std::string& input,
+    const OptionSet& options) const {
+  TranslationResult result;
+  ScopedDiagnostics scoped_diagnostics(&result.diagnostics);
+  result.output = Translate(input, options);
+  return result;
+}
+
+std::unique_ptr<TranslationLayout> Translator::ComputeLayout(
+    const std::string& input,
+    const OptionSet& options) const {
+  return nullptr;
+}
+
+std::vector<std::string> Translator::TranslateMany(
+    const std::string& input,
+    const std::vector<OptionSet>& options) const {
+  // The indices of the option sets, grouped by layout.
+  std::map<std::string, std::vector<size_t>> groups;
+  for (size_t i = 0; i < options.size(); ++i)
+    groups[options[i].LayoutKey()].push_back(i);
+
+  std::vector<std::string> outputs(options.size());
+  for (const auto& [key, indices] : groups) {
+    auto layout = ComputeLayout(input, options[indices[0]]);
+
+    // Equal option sets share their output too.
+    std::map<std::string, size_t> drawn;
+    for (size_t i : indices) {
+      auto [it, inserted] = drawn.emplace(options[i].Serialize(), i);
+      if (!inserted)
+        outputs[i] = outputs[it->second];
+      else if (layout)
+        layout->Rasterize(options[i], StringSink(&outputs[i]).get());
+      else
+        outputs[i] = Translate(input, options[i]);
+    }
+  }
+  return outputs;
+}
+
+std::vector<std::string> Translator::TranslateMany(
+    const std::string& input,
+    const std::vector<std::string>& options) const {
+  std::vector<OptionSet> compiled;
+  compiled.reserve(options.size());
+  for (const std::string& it : options)
+    compiled.push_back(CompileOptions(it));
+  return TranslateMany(input, compiled);
+}
+
+std::unique_ptr<TranslationSession> Translator::OpenSession(
+    const std::string& input,
+    const OptionSet& options) const {
+  return std::make_unique<LayoutSession>(this, input, options);
+}
+
+void TranslationSession::ApplyEdit(size_t offset,
+                                   size_t length,
+                                   std::string_view text) {
+  offset = std::min(offset, input_.size());
+  length = std::min(length, input_.size() - offset);
+  input_.replace(offset, length, text);
+  OnEdit(offset, length, text.size());
+}
+
+void TranslationSession::SetInput(std::string_view input) {
+  size_t prefix = 0;
+  size_t max_prefix = std::min(input.size(), input_.size());
+  while (prefix < max_prefix && input[prefix] == input_[prefix])
+    ++prefix;
+
+  size_t suffix = 0;
+  size_t max_suffix = max_prefix - prefix;
+  while (suffix < max_suffix &&
+         input[input.size() - 1 - suffix] == input_[input_.size() - 1 - suffix])
+    ++suffix;
+
+  if (prefix == input.size() && prefix == input_.size())
+    return;
+
+  ApplyEdit(prefix, input_.size() - prefix - suffix,
+            input.substr(prefix, input.size() - prefix - suffix));
+}
+
+std::string TranslationSession::Render() {
+  std::string output;
+  RenderTo(StringSink(&output).get());
+  return output;
+}
+
+OptionSet::OptionSet(
+    const std::vector<Translator::OptionDescription>& descriptions,
+    const std::string& options) {
+  entries_.reserve(descriptions.size());
+  for (const auto& description : descriptions) {
+    entries_.push_back({description.name, description.default_value,
+                        description.default_value == "true",
+                        description.style});
+  }
+
+  // Parse the "name\nvalue\n" pairs. The last value of an option wins.
+  std::string_view view = options;
+  while (!view.empty()) {
+    size_t name_end = view.find('\n');
+    if (name_end == std::string_view::npos || name_end + 1 == view.size())
+      break;
+    size_t value_end = view.find('\n', name_end + 1);
+    if (value_end == std::string_view::npos)
+      value_end = view.size();
+    std::string_view name = view.substr(0, name_end);
+    std::string_view value =
+        view.substr(name_end + 1, value_end - name_end - 1);
+    view.remove_prefix(std::min(value_end + 1, view.size()));
+
+    auto description = std::find_if(
+        descriptions.begin(), descriptions.end(),
+        [&](const auto& description) { return description.name == name; });
+    if (description == descriptions.end()) {
+      errors_.push_back("Unknown option: " + std::string(name));
+      continue;
+    }
+
+    const auto& values = description->values;
+    if (!values.empty() &&
+        std::find(values.begin(), values.end(), value) == values.end()) {
+      errors_.push_back("Invalid value for option " + std::string(name) +
+                        ": " + std::string(value));
+      continue;
+    }
+
+    Entry& entry = entries_[description - descriptions.begin()];
+    entry.value = value;
+    entry.flag = (value == "true");
+  }
+}
+
+const std::string& OptionSet::Get(std::string_view name) const {
+  static const std::string empty;
+  for (const Entry& entry : entries_) {
+    if (entry.name == name)
+      return entry.value;
+  }
+  return empty;
+}
+
+bool OptionSet::GetBool(std::string_view name) const {
+  for (const Entry& entry : entries_) {
+    if (entry.name == name)
+      return entry.flag;
+  }
+  return false;
+}
+
+std::string OptionSet::Serialize() const {
+  std::string out;
+  for (const Entry& entry : entries_) {
+    out += entry.name;
+    out += '\n';
+    out += entry.value;
+    out += '\n';
+  }
+  return out;
+}
+
+std::string OptionSet::LayoutKey() const {
+  std::string out;
+  for (const Entry& entry : entries_) {
+    if (entry.style)
+      continue;
+    out += entry.name;
+    out += '\n';
+    out += entry.value;
+    out += '\n';
   }
-  return m;
+  return out;
 }
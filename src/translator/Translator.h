@@ -1,18 +1,75 @@
 #ifndef TRANSLATOR_TRANSLATOR
 #define TRANSLATOR_TRANSLATOR
 
-#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "translator/Diagnostics.h"
+
+class OptionSet;
+class Sink;
+class TranslationLayout;
+class TranslationSession;
+
 class Translator {
  public:
   // Main API implemented by translator. ---------------------------------------
+  // Translations are reentrant: the per-call state lives in a context object,
+  // so that a translator can be used from several threads at once.
+  // Their work can be bounded with a |ScopedTranslationBudget|, see Budget.h.
+  // The problems found in the input are reported as diagnostics, see
+  // Diagnostics.h.
   virtual std::string Translate(const std::string& input,
-                                const std::string& option) = 0;
+                                const OptionSet& options) const = 0;
+  // Same as |Translate|, but write the output to |sink|. Translators producing
+  // large outputs override it to avoid materializing them.
+  virtual void TranslateTo(const std::string& input,
+                           const OptionSet& options,
+                           Sink* sink) const;
   virtual std::string Highlight(const std::string& input) { return input; }
   virtual ~Translator() = default;
 
+  // Same as above, with the options in the "name\nvalue\n..." format. They are
+  // compiled on every call. Prefer compiling them once with |CompileOptions|.
+  std::string Translate(const std::string& input,
+                        const std::string& options) const;
+  void TranslateTo(const std::string& input,
+                   const std::string& options,
+                   Sink* sink) const;
+  OptionSet CompileOptions(const std::string& options) const;
+
+  // Same as |Translate|, returning the diagnostics along with the output.
+  TranslationResult TranslateWithDiagnostics(const std::string& input,
+                                             const OptionSet& options) const;
+
+  // Retained layouts ----------------------------------------------------------
+  // Parse and lay |input| out once, for the layout to be drawn in the style of
+  // several option sets. The |style| options are ignored. Returns nullptr for
+  // translators without retained layouts.
+  virtual std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const;
+
+  // Translate |input| once per option set. The option sets differing only by
+  // their |style| options share a single parse and layout.
+  std::vector<std::string> TranslateMany(
+      const std::string& input,
+      const std::vector<OptionSet>& options) const;
+  // Same as above, with the options in the "name\nvalue\n..." format.
+  std::vector<std::string> TranslateMany(
+      const std::string& input,
+      const std::vector<std::string>& options) const;
+
+  // Incremental sessions ------------------------------------------------------
+  // Translate an input edited over time, e.g. by an editor on every keystroke,
+  // reusing what the edits didn't damage. The translator must outlive the
+  // session. See |TranslationSession|.
+  virtual std::unique_ptr<TranslationSession> OpenSession(
+      const std::string& input,
+      const OptionSet& options) const;
+
   // Reflection API ------------------------------------------------------------
   virtual const char* Identifier() { return ""; }
   virtual const char* Name() { return ""; }
@@ -25,12 +82,16 @@ class Translator {
 
   struct OptionDescription {
     std::string name;
+    // The accepted values. Any value is accepted when empty.
     std::vector<std::string> values;
     std::string default_value;
     std::string description;
     Widget type;
+    // Whether the option only changes how a layout is drawn. See
+    // |ComputeLayout|.
+    bool style = false;
   };
-  virtual std::vector<OptionDescription> Options() { return {}; }
+  virtual std::vector<OptionDescription> Options() const { return {}; }
 
   struct Example {
     std::string title;
@@ -39,6 +100,77 @@ class Translator {
   virtual std::vector<Example> Examples() { return {}; }
 };
 
-std::map<std::string, std::string> SerializeOption(const std::string& options);
+// A translation laid out by |Translator::ComputeLayout|, independently of the
+// style options.
+class TranslationLayout {
+ public:
+  virtual ~TranslationLayout() = default;
+  // Draw the layout into |sink|, in the style of |options|. Only the |style|
+  // options are read.
+  virtual void Rasterize(const OptionSet& options, Sink* sink) const = 0;
+};
+
+// An input edited over time, and its translation. Created by
+// |Translator::OpenSession|. By default, the layout is kept until the next
+// edit; translators override |OpenSession| to keep more.
+class TranslationSession {
+ public:
+  virtual ~TranslationSession() = default;
+
+  // Replace the |length| bytes of the input at |offset| with |text|.
+  void ApplyEdit(size_t offset, size_t length, std::string_view text);
+  // Replace the input with |input|, as a single edit of the bytes between
+  // their common prefix and suffix.
+  void SetInput(std::string_view input);
+  const std::string& input() const { return input_; }
+
+  // The translation of the current input.
+  std::string Render();
+  virtual void RenderTo(Sink* sink) = 0;
+
+ protected:
+  explicit TranslationSession(std::string input) : input_(std::move(input)) {}
+
+  // Called by |ApplyEdit| once |input_| is edited: the |removed| bytes at
+  // |offset| were replaced by |inserted| bytes.
+  virtual void OnEdit(size_t offset, size_t removed, size_t inserted) = 0;
+
+  std::string input_;
+};
+
+// The options of a translation, parsed and checked against the translator's
+// |Options()| once, so that they can be reused by many translations.
+class OptionSet {
+ public:
+  OptionSet(const std::vector<Translator::OptionDescription>& descriptions,
+            const std::string& options);
+
+  // The value of the option |name|, or its default value when it is missing or
+  // invalid. Empty for undeclared options.
+  const std::string& Get(std::string_view name) const;
+  // The value of the Checkbox option |name|.
+  bool GetBool(std::string_view name) const;
+
+  // Every declared option with its value, in the "name\nvalue\n..." format.
+  // Equal for option strings differing only by order, defaults or errors.
+  std::string Serialize() const;
+  // Same as |Serialize|, without the |style| options. Option sets with equal
+  // keys share their layout. See |Translator::ComputeLayout|.
+  std::string LayoutKey() const;
+
+  // The unknown option names and the invalid values, one message each.
+  const std::vector<std::string>& errors() const { return errors_; }
+  bool ok() const { return errors_.empty(); }
+
+ private:
+  struct Entry {
+    std::string name;
+    std::string value;
+    bool flag = false;
+    bool style = false;
+  };
+  std::vector<Entry> entries_;
+  std::vector<std::string> errors_;
+};
 
 #endif /* end of include guard: TRANSLATOR_TRANSLATOR */
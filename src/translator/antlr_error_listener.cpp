@@ -11,3 +11,8 @@ void AntlrErrorListener::syntaxError(antlr4::Recognizer* recognizer,
   s << "Line(" << line << ":" << charPositionInLine << ") Error(" << msg << ")";
   throw std::invalid_argument(s.str());
 }
+
+std::mutex& AntlrMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
@@ -2,6 +2,7 @@
 #define TRANSLATOR_ANTLR_ERROR_LISTENER_HPP
 
 #include <antlr4-runtime.h>
+#include <mutex>
 
 class AntlrErrorListener : public antlr4::BaseErrorListener {
   void syntaxError(antlr4::Recognizer* recognizer,
@@ -12,4 +13,9 @@ class AntlrErrorListener : public antlr4::BaseErrorListener {
                    std::exception_ptr e) final;
 };
 
+// Held while lexing and parsing. The generated lexers and parsers share their
+// prediction caches between instances, and the ANTLR runtime used here doesn't
+// synchronize them.
+std::mutex& AntlrMutex();
+
 #endif  // TRANSLATOR_ANTLR_ERROR_LISTENER_HPP
@@ -3,10 +3,15 @@
 // the LICENSE file.
 
 #include <algorithm>
+#include <map>
 #include <string>
 #include <string_view>
 #include <vector>
+#include "screen/Connection.h"
+#include "screen/Scene.h"
 #include "screen/Screen.h"
+#include "screen/Sink.h"
+#include "translator/Budget.h"
 #include "translator/Translator.h"
 #include "translator/antlr_error_listener.h"
 #include "translator/flowchart/FlowchartLexer.h"
@@ -15,6 +20,21 @@
 
 namespace {
 
+// The drawing of a program, or the reason it couldn't be drawn.
+class FlowchartLayout : public TranslationLayout {
+ public:
+  void Rasterize(const OptionSet& options, Sink* sink) const override {
+    if (!error.empty()) {
+      sink->Write(error);
+      return;
+    }
+    scene.Rasterize().Write(sink);
+  }
+
+  Scene scene;
+  std::string error;
+};
+
 class Flowchart : public Translator {
  public:
   virtual ~Flowchart() = default;
@@ -25,10 +45,21 @@ class Flowchart : public Translator {
   const char* Description() final {
     return "Transform a program into ascii art flowchart";
   }
-  std::vector<Translator::OptionDescription> Options() final { return {}; }
+  std::vector<Translator::OptionDescription> Options() const final {
+    return {};
+  }
   std::vector<Translator::Example> Examples() final;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) final;
+                        const OptionSet& options) const final;
+  void TranslateTo(const std::string& input,
+                   const OptionSet& options,
+                   Sink* sink) const final;
+  std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const final;
+  std::unique_ptr<TranslationSession> OpenSession(
+      const std::string& input,
+      const OptionSet& options) const final;
   std::string Highlight(const std::string& input) final;
 };
 
@@ -109,7 +140,7 @@ void operator+=(Point& a, const Point& b) {
 }
 
 struct Draw {
-  Screen screen;
+  Scene scene;
   std::vector<Point> top;
   std::vector<Point> left;
   std::vector<Point> bottom;
@@ -117,14 +148,11 @@ struct Draw {
   bool returned = false;
 };
 
-std::vector<Point> Merge(const std::vector<Point> a,
-                         const std::vector<Point> b) {
-  std::vector<Point> out;
-  for (Point it : a)
-    out.push_back(it);
-  for (Point it : b)
-    out.push_back(it);
-  return out;
+// |a| is taken by value, so that chaining many instructions appends to the
+// same vector instead of copying it every time.
+std::vector<Point> Merge(std::vector<Point> a, const std::vector<Point>& b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
 }
 
 void Shift(std::vector<Point>& out, Point shift) {
@@ -134,20 +162,26 @@ void Shift(std::vector<Point>& out, Point shift) {
 }
 
 void Shift(Draw& out, Point shift) {
+  if (shift.x == 0 && shift.y == 0)
+    return;
   Shift(out.top, shift);
   Shift(out.left, shift);
   Shift(out.bottom, shift);
   Shift(out.right, shift);
 }
 
-Point static_point_1;
-Point static_point_2;
+// Append |scene| into the empty |out| scene at |shift|. When there is no
+// shift, the storage of |scene| is reused instead of being copied. This keeps
+// composing long programs linear.
+void AppendInPlace(Scene& out, Scene scene, Point shift) {
+  if (shift.x == 0 && shift.y == 0)
+    out = std::move(scene);
+  else
+    out.Append(scene, shift.x, shift.y);
+}
 
-Draw ConnectVertically(Draw a,
-                       Draw b,
-                       Point& a_shift = static_point_1,
-                       Point& b_shift = static_point_2) {
-  int height = a.screen.height();
+Draw ConnectVertically(Draw a, Draw b, Point& a_shift, Point& b_shift) {
+  int height = a.scene.height();
   if (height == 0)
     return b;
 
@@ -156,11 +190,11 @@ Draw ConnectVertically(Draw a,
     b_shift = Point{0, height};
 
     Draw out;
-    out.screen.Append(a.screen, a_shift.x, a_shift.y);
-    out.screen.Append(b.screen, b_shift.x, b_shift.y);
+    out.scene = std::move(a.scene);
+    out.scene.Append(b.scene, b_shift.x, b_shift.y);
 
-    out.left = Merge(a.left, b.left);
-    out.right = Merge(a.right, b.right);
+    out.left = Merge(std::move(a.left), b.left);
+    out.right = Merge(std::move(a.right), b.right);
     out.top = a.top;
     out.bottom = b.bottom;
     out.returned = b.returned;
@@ -176,44 +210,37 @@ Draw ConnectVertically(Draw a,
   b_shift.x += shifting;
 
   Draw out;
-  out.screen.Append(a.screen, a_shift.x, a_shift.y);
-  out.screen.Append(b.screen, b_shift.x, b_shift.y);
+  AppendInPlace(out.scene, std::move(a.scene), a_shift);
+  out.scene.Append(b.scene, b_shift.x, b_shift.y);
 
   Shift(a, a_shift);
   Shift(b, b_shift);
 
-  out.left = Merge(a.left, b.left);
-  out.right = Merge(a.right, b.right);
+  out.left = Merge(std::move(a.left), b.left);
+  out.right = Merge(std::move(a.right), b.right);
   out.top = a.top;
   out.bottom = b.bottom;
   out.returned = b.returned;
 
-  out.screen.DrawVerticalLineComplete(a.bottom[0].y + 1, b.top[0].y - 1,
-                                      a.bottom[0].x);
+  out.scene.DrawVerticalLineComplete(a.bottom[0].y + 1, b.top[0].y - 1,
+                                     a.bottom[0].x);
 
-  auto& top = out.screen.Pixel(a.bottom[0].x, a.bottom[0].y);
-  if (top == L'─')
-    top = L'┬';
+  out.scene.Connect(a.bottom[0].x, a.bottom[0].y, kDown);
 
-  auto& bottom = out.screen.Pixel(b.top[0].x, b.top[0].y);
-  if (bottom == L'─')
-    bottom = L'▽';
-  if (bottom == L'-')
-    bottom = L'▽';
-  if (bottom == L'_')
-    bottom = L'▽';
-  if (bottom == L' ')
-    bottom = L'│';
+  out.scene.DrawArrowHead(b.top[0].x, b.top[0].y);
 
   out.returned = b.returned;
   return out;
 }
 
-Draw ConnectHorizontally(Draw a,
-                         Draw b,
-                         Point& a_shift = static_point_1,
-                         Point& b_shift = static_point_2) {
-  int width = a.screen.width();
+Draw ConnectVertically(Draw a, Draw b) {
+  Point a_shift;
+  Point b_shift;
+  return ConnectVertically(std::move(a), std::move(b), a_shift, b_shift);
+}
+
+Draw ConnectHorizontally(Draw a, Draw b, Point& a_shift, Point& b_shift) {
+  int width = a.scene.width();
   if (width == 0) {
     return b;
   }
@@ -232,50 +259,55 @@ Draw ConnectHorizontally(Draw a,
   b_shift.y += shifting;
 
   Draw out;
-  out.screen.Append(a.screen, a_shift.x, a_shift.y);
-  out.screen.Append(b.screen, b_shift.x, b_shift.y);
+  AppendInPlace(out.scene, std::move(a.scene), a_shift);
+  out.scene.Append(b.scene, b_shift.x, b_shift.y);
 
   Shift(a, a_shift);
   Shift(b, b_shift);
 
-  out.top = Merge(a.top, b.top);
+  out.top = Merge(std::move(a.top), b.top);
   out.left = a.left;
   out.right = b.right;
-  out.bottom = Merge(a.bottom, b.bottom);
+  out.bottom = Merge(std::move(a.bottom), b.bottom);
 
   out.returned = a.returned || b.returned;
 
-  out.screen.DrawHorizontalLine(a.right[0].x + 1, b.left[0].x - 1, a.right[0].y,
-                                L'_');
+  out.scene.DrawHorizontalLine(a.right[0].x + 1, b.left[0].x - 1, a.right[0].y,
+                               L'_');
   return out;
 }
 
+Draw ConnectHorizontally(Draw a, Draw b) {
+  Point a_shift;
+  Point b_shift;
+  return ConnectHorizontally(std::move(a), std::move(b), a_shift, b_shift);
+}
+
 Draw MergeBottoms(Draw draw) {
   if (draw.bottom.size() <= 1) {
     return draw;
   }
-  draw.screen.Resize(draw.screen.width(), draw.screen.height() + 1);
+  draw.scene.Resize(draw.scene.width(), draw.scene.height() + 1);
 
   int left = draw.bottom.front().x;
   int right = draw.bottom.back().x;
-  draw.screen.DrawHorizontalLine(left, right, draw.screen.height() - 1, L'─');
+  int y = draw.scene.height() - 1;
+
+  // Collect the connections of the bottom line, then draw it at once.
+  std::vector<int> line(right - left + 1, kLeft | kRight);
+  line.front() &= ~kLeft;
+  line.back() &= ~kRight;
 
   for (auto& it : draw.bottom) {
-    draw.screen.DrawVerticalLine(it.y + 1, draw.screen.height() - 2, it.x,
-                                 L'│');
-    auto& top = draw.screen.Pixel(it.x, it.y);
-    if (top == L'─')
-      top = L'┬';
-
-    auto& bottom = draw.screen.Pixel(it.x, draw.screen.height() - 1);
-    if (bottom == L'─')
-      bottom = L'┴';
+    draw.scene.DrawVerticalLine(it.y + 1, y - 1, it.x, L'│');
+    draw.scene.Connect(it.x, it.y, kDown);
+    line[it.x - left] |= kUp;
   }
 
-  draw.screen.Pixel(left, draw.screen.height() - 1) = L'└';
-  draw.screen.Pixel(right, draw.screen.height() - 1) = L'┘';
+  for (int x = left; x <= right; ++x)
+    draw.scene.DrawPixel(x, y, ConnectionGlyph(line[x - left]));
 
-  draw.bottom = {{(5 * left + 2 * right) / 7, draw.screen.height() - 1}};
+  draw.bottom = {{(5 * left + 2 * right) / 7, draw.scene.height() - 1}};
   return draw;
 }
 
@@ -294,7 +326,7 @@ Draw ParseUnmerged(FlowchartParser::ConditionContext* condition, bool is_final);
 
 Draw Noop() {
   Draw draw;
-  draw.screen.Resize(1, 1);
+  draw.scene.Resize(1, 1);
   draw.left = {{0, 0}};
   draw.right = {{0, 0}};
   draw.bottom = {{0, 0}};
@@ -381,6 +413,7 @@ std::vector<std::wstring_view> Broke(std::wstring_view content) {
     return {content};
 
   do {
+    BudgetStep(content.size());
     right--;
   } while (Broke(content, right).size() == lines_number && right >= 0);
   right++;
@@ -432,26 +465,26 @@ Draw Diamond(std::string content, bool is_final) {
   width = width + height + 2;
 
   Draw out;
-  out.screen.Resize(width, height + 3);
+  out.scene.Resize(width, height + 3);
 
   for (int x = height / 2 + 1; x < width - height / 2 - 1; ++x) {
-    out.screen.Pixel(x, 0) = L'_';
-    out.screen.Pixel(x, height + 2) = L'_';
+    out.scene.DrawPixel(x, 0, L'_');
+    out.scene.DrawPixel(x, height + 2, L'_');
   }
 
   for (int i = 0; i < height / 2 + 1; ++i) {
     int I = width - i - 1;
-    out.screen.Pixel(i, 1 + height / 2 - i + 0) = L'╱';
-    out.screen.Pixel(i, 1 + height / 2 + i + 1) = L'╲';
-    out.screen.Pixel(I, 1 + height / 2 - i + 0) = L'╲';
-    out.screen.Pixel(I, 1 + height / 2 + i + 1) = L'╱';
+    out.scene.DrawPixel(i, 1 + height / 2 - i + 0, L'╱');
+    out.scene.DrawPixel(i, 1 + height / 2 + i + 1, L'╲');
+    out.scene.DrawPixel(I, 1 + height / 2 - i + 0, L'╲');
+    out.scene.DrawPixel(I, 1 + height / 2 + i + 1, L'╱');
   }
 
   for (int i = 0; i < lines.size(); ++i)
-    out.screen.DrawText(height / 2 + 1, i + 2, lines[i]);
+    out.scene.DrawText(height / 2 + 1, i + 2, lines[i]);
 
-  width = out.screen.width();
-  height = out.screen.height();
+  width = out.scene.width();
+  height = out.scene.height();
 
   out.top = {{width / 2 - 1 + width % 2, 0}};
   out.bottom = {{width / 2 - 1 + width % 2, height - 1}};
@@ -472,10 +505,10 @@ Draw Boxed(std::string content, bool is_final) {
   int height = 2 + lines.size();
 
   Draw draw;
-  draw.screen.Resize(width, height);
-  draw.screen.DrawBox(0, 0, width, height);
+  draw.scene.Resize(width, height);
+  draw.scene.DrawBox(0, 0, width, height);
   for (int i = 0; i < lines.size(); ++i)
-    draw.screen.DrawText(1, 1 + i, lines[i]);
+    draw.scene.DrawText(1, 1 + i, lines[i]);
 
   draw.top = {{width / 2, 0}};
   draw.bottom = {{width / 2, height - 1}};
@@ -488,20 +521,20 @@ Draw Boxed(std::string content, bool is_final) {
 
 // Draw Text(std::string content, bool is_final) {
 // Draw draw;
-// draw.screen.Resize(content.size() + 5, 3);
-// draw.screen.DrawText(2, 1, to_wstring(content));
+// draw.scene.Resize(content.size() + 5, 3);
+// draw.scene.DrawText(2, 1, to_wstring(content));
 
-// draw.top.x = draw.screen.width() / 2;
+// draw.top.x = draw.scene.width() / 2;
 // draw.top.y = 0;
 
-// draw.bottom.x = draw.screen.width() / 2;
-// draw.bottom.y = draw.screen.height() - 1;
+// draw.bottom.x = draw.scene.width() / 2;
+// draw.bottom.y = draw.scene.height() - 1;
 
 // draw.left.x = 0;
-// draw.left.y = draw.screen.height() / 2;
+// draw.left.y = draw.scene.height() / 2;
 
-// draw.right.x = draw.screen.width() - 1;
-// draw.right.y = draw.screen.height() / 2;
+// draw.right.x = draw.scene.width() - 1;
+// draw.right.y = draw.scene.height() / 2;
 
 // draw.returned = is_final;
 // return draw;
@@ -533,17 +566,17 @@ Draw Parse(FlowchartParser::ElementContext* element, bool is_final) {
   return Boxed(Parse(element->string()), is_final);
 }
 
-void AddLabel(Screen& screen, Point point, std::wstring_view label) {
-  Screen label_screen(label.size(), 1);
-  label_screen.DrawText(0, 0, label);
-  screen.Append(label_screen, point.x + 1, point.y + 1);
+void AddLabel(Scene& scene, Point point, std::wstring_view label) {
+  scene.Resize(std::max(scene.width(), point.x + 1 + int(label.size())),
+               std::max(scene.height(), point.y + 2));
+  scene.DrawText(point.x + 1, point.y + 1, label);
 }
 
 Draw ParseUnmerged(FlowchartParser::ConditionContext* condition,
                    bool is_final) {
   Draw if_ = Diamond(Parse(condition->string()), /*is_final=*/false);
-  AddLabel(if_.screen, if_.bottom[0], L"no");
-  AddLabel(if_.screen, if_.right[0], L"yes");
+  AddLabel(if_.scene, if_.bottom[0], L"no");
+  AddLabel(if_.scene, if_.right[0], L"yes");
   Draw then_ = Parse(condition->instruction()[0], is_final);
 
   // An 'if' without an 'else':
@@ -620,8 +653,45 @@ Draw Parse(FlowchartParser::ProgramContext* program, bool is_final) {
   return out;
 }
 
-std::string Flowchart::Translate(const std::string& input,
-                                 const std::string& options_string) {
+// The drawings of the top level instructions of a program, by source text and
+// |is_final|.
+using DrawingCache = std::map<std::pair<std::string, bool>, Draw>;
+
+// Same as |Parse|, drawing the instructions found in |cache| from it. |cache|
+// is replaced by the drawings of |program|.
+Draw Parse(FlowchartParser::ProgramContext* program,
+           antlr4::TokenStream* tokens,
+           DrawingCache* cache) {
+  DrawingCache drawings;
+  Draw out;
+  int n = program->instruction().size();
+  for (int i = 0; i < n; ++i) {
+    FlowchartParser::InstructionContext* instruction =
+        program->instruction()[i];
+    auto key = std::make_pair(tokens->getText(instruction), i == n - 1);
+    auto it = drawings.find(key);
+    if (it == drawings.end()) {
+      auto cached = cache->find(key);
+      Draw draw = cached != cache->end() ? std::move(cached->second)
+                                         : Parse(instruction, key.second);
+      it = drawings.emplace(std::move(key), std::move(draw)).first;
+    }
+
+    out = MergeBottoms(std::move(out));
+    out = ConnectVertically(std::move(out), it->second);
+  }
+  *cache = std::move(drawings);
+  return out;
+}
+
+// Lay |input| out. When |cache| isn't null, the top level instructions are
+// drawn from it. See |DrawingCache|.
+std::unique_ptr<TranslationLayout> Layout(const std::string& input,
+                                          DrawingCache* cache) {
+  auto layout = std::make_unique<FlowchartLayout>();
+
+  // Lexers and parsers share caches. See |AntlrMutex|.
+  std::unique_lock<std::mutex> lock(AntlrMutex());
   antlr4::ANTLRInputStream input_stream(input);
 
   // Lexer.
@@ -639,15 +709,72 @@ std::string Flowchart::Translate(const std::string& input,
   try {
     context = parser.program();
   } catch (...) {
-    return "Error";
+    layout->error = "Error";
+    return layout;
+  }
+  lock.unlock();
+
+  if (cache)
+    layout->scene = Parse(context, &tokens, cache).scene;
+  else
+    layout->scene = Parse(context, true).scene;
+  return layout;
+}
+
+// Keeps the drawings of the top level instructions. After an edit, the input
+// is parsed again, but only the instructions whose source changed are drawn
+// again.
+class FlowchartSession : public TranslationSession {
+ public:
+  FlowchartSession(std::string input, const OptionSet& options)
+      : TranslationSession(std::move(input)), options_(options) {}
+
+  void RenderTo(Sink* sink) override {
+    if (!layout_)
+      layout_ = Layout(input_, &cache_);
+    layout_->Rasterize(options_, sink);
+  }
+
+ private:
+  void OnEdit(size_t offset, size_t removed, size_t inserted) override {
+    layout_.reset();
   }
 
-  return Parse(context, true).screen.ToString();
+  OptionSet options_;
+  DrawingCache cache_;
+  std::unique_ptr<TranslationLayout> layout_;
+};
+
+std::string Flowchart::Translate(const std::string& input,
+                                 const OptionSet& options) const {
+  std::string output;
+  TranslateTo(input, options, StringSink(&output).get());
+  return output;
+}
+
+void Flowchart::TranslateTo(const std::string& input,
+                            const OptionSet& options,
+                            Sink* sink) const {
+  ComputeLayout(input, options)->Rasterize(options, sink);
+}
+
+std::unique_ptr<TranslationLayout> Flowchart::ComputeLayout(
+    const std::string& input,
+    const OptionSet& options) const {
+  return Layout(input, nullptr);
+}
+
+std::unique_ptr<TranslationSession> Flowchart::OpenSession(
+    const std::string& input,
+    const OptionSet& options) const {
+  return std::make_unique<FlowchartSession>(input, options);
 }
 
 std::string Flowchart::Highlight(const std::string& input) {
   std::stringstream out;
 
+  // Lexers and parsers share caches. See |AntlrMutex|.
+  std::lock_guard<std::mutex> lock(AntlrMutex());
   antlr4::ANTLRInputStream input_stream(input);
 
   // Lexer.
@@ -682,16 +809,16 @@ std::string Flowchart::Highlight(const std::string& input) {
 
 Draw Parse(FlowchartParser::WhileloopContext* whileloop, bool is_final) {
   Draw if_ = Diamond(Parse(whileloop->string()), /*is_final=*/false);
-  Screen if_screen;
-  std::swap(if_.screen, if_screen);
-  if_.screen.Append(std::move(if_screen), 4, 0);
+  Scene if_scene;
+  std::swap(if_.scene, if_scene);
+  if_.scene.Append(std::move(if_scene), 4, 0);
   Shift(if_, Point{4, 0});
 
-  AddLabel(if_.screen, if_.bottom[0], L"yes");
+  AddLabel(if_.scene, if_.bottom[0], L"yes");
 
   Point no_position = if_.left[0];
   no_position.x -= 4;
-  AddLabel(if_.screen, no_position, L"no");
+  AddLabel(if_.scene, no_position, L"no");
 
   Draw instruction = Parse(whileloop->instruction(), is_final);
   instruction = MergeBottoms(instruction);
@@ -707,8 +834,8 @@ Draw Parse(FlowchartParser::WhileloopContext* whileloop, bool is_final) {
   if_right += if_shift;
 
   Draw out;
-  out.screen.Append(merged.screen, 1, 0);
-  out.screen.Resize(out.screen.width() + 2, out.screen.height() + 1);
+  out.scene.Append(merged.scene, 1, 0);
+  out.scene.Resize(out.scene.width() + 2, out.scene.height() + 1);
 
   //  --- if_left                   if_right ----
   //                                            |
@@ -717,25 +844,21 @@ Draw Parse(FlowchartParser::WhileloopContext* whileloop, bool is_final) {
   //                     |                      |
   //                     -----------------------
 
-  out.screen.DrawHorizontalLine(1, if_left.x, if_left.y, '_');
+  out.scene.DrawHorizontalLine(1, if_left.x, if_left.y, '_');
 
   if (merged.bottom.size()) {
-    out.screen.DrawHorizontalLine(if_right.x + 2, out.screen.width() - 2,
-                                  if_right.y, '_');
-    out.screen.DrawHorizontalLine(merged.bottom[0].x + 2,
-                                  out.screen.width() - 1,
-                                  out.screen.height() - 1, L'─');
-    out.screen.DrawVerticalLineComplete(merged.bottom[0].y + 1,
-                                        out.screen.height() - 2,
-                                        merged.bottom[0].x + 1);
-    out.screen.DrawVerticalLineComplete(if_right.y + 1, out.screen.height() - 1,
-                                        out.screen.width() - 1);
-    out.screen.Pixel(merged.bottom[0].x + 1, out.screen.height() - 1) = L'└';
-    out.screen.Pixel(out.screen.width() - 1, out.screen.height() - 1) = L'┘';
-    auto& connector =
-        out.screen.Pixel(merged.bottom[0].x + 1, merged.bottom[0].y);
-    if (connector == L'─')
-      connector = L'┬';
+    out.scene.DrawHorizontalLine(if_right.x + 2, out.scene.width() - 2,
+                                 if_right.y, '_');
+    out.scene.DrawHorizontalLine(merged.bottom[0].x + 2, out.scene.width() - 1,
+                                 out.scene.height() - 1, L'─');
+    out.scene.DrawVerticalLineComplete(merged.bottom[0].y + 1,
+                                       out.scene.height() - 2,
+                                       merged.bottom[0].x + 1);
+    out.scene.DrawVerticalLineComplete(if_right.y + 1, out.scene.height() - 1,
+                                       out.scene.width() - 1);
+    out.scene.DrawPixel(merged.bottom[0].x + 1, out.scene.height() - 1, L'└');
+    out.scene.DrawPixel(out.scene.width() - 1, out.scene.height() - 1, L'┘');
+    out.scene.Connect(merged.bottom[0].x + 1, merged.bottom[0].y, kDown);
   }
 
   out.top = {merged.top[0] + if_shift};
@@ -768,30 +891,30 @@ Draw Parse(FlowchartParser::DoloopContext* doloop, bool is_final) {
   merged.left = {};
   merged.right = {};
 
-  AddLabel(merged.screen, merged.bottom[0], L"no");
-  AddLabel(merged.screen, merged.right[0], L"yes");
+  AddLabel(merged.scene, merged.bottom[0], L"no");
+  AddLabel(merged.scene, merged.right[0], L"yes");
 
   // |___
   // |
   // Add 2 empty line above
-  Screen merged_screen;
-  std::swap(merged.screen, merged_screen);
-  merged.screen.Resize(merged_screen.width() + 1, merged_screen.height() + 2);
-  merged.screen.Append(std::move(merged_screen), 0, 2);
+  Scene merged_scene;
+  std::swap(merged.scene, merged_scene);
+  merged.scene.Resize(merged_scene.width() + 1, merged_scene.height() + 2);
+  merged.scene.Append(std::move(merged_scene), 0, 2);
   Shift(merged, Point{0, 2});
 
-  merged.screen.DrawHorizontalLine(merged.right[0].x + 1,
-                                   merged.screen.width() - 1,
-                                   merged.right[0].y + 2, L'_');
-  merged.screen.DrawHorizontalLine(merged.top[0].x + 1,
-                                   merged.screen.width() - 1, 1, L'─');
-  merged.screen.DrawVerticalLineComplete(1, merged.right[0].y + 2,
-                                         merged.screen.width() - 1);
+  merged.scene.DrawHorizontalLine(merged.right[0].x + 1,
+                                  merged.scene.width() - 1,
+                                  merged.right[0].y + 2, L'_');
+  merged.scene.DrawHorizontalLine(merged.top[0].x + 1, merged.scene.width() - 1,
+                                  1, L'─');
+  merged.scene.DrawVerticalLineComplete(1, merged.right[0].y + 2,
+                                        merged.scene.width() - 1);
 
-  merged.screen.DrawVerticalLineComplete(0, 2, merged.top[0].x);
+  merged.scene.DrawVerticalLineComplete(0, 2, merged.top[0].x);
 
-  merged.screen.Pixel(merged.screen.width() - 1, 1) = L'╮';
-  merged.screen.Pixel(merged.top[0].x + 1, 1) = L'◁';
+  merged.scene.DrawPixel(merged.scene.width() - 1, 1, L'╮');
+  merged.scene.DrawPixel(merged.top[0].x + 1, 1, L'◁');
   return merged;
 }
 
@@ -6,7 +6,10 @@
 #include <sstream>
 #include <vector>
 
+#include "screen/DrawList.h"
+#include "screen/InternedRows.h"
 #include "screen/Screen.h"
+#include "screen/Sink.h"
 #include "translator/Translator.h"
 
 class Frame : public Translator {
@@ -17,13 +20,16 @@ class Frame : public Translator {
   const char* Description() final {
     return "Draw a box around the input with (optional) line number";
   }
-  std::vector<Translator::OptionDescription> Options() final;
+  std::vector<Translator::OptionDescription> Options() const final;
   std::vector<Translator::Example> Examples() final;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) final;
+                        const OptionSet& options) const final;
+  void TranslateTo(const std::string& input,
+                   const OptionSet& options,
+                   Sink* sink) const final;
 };
 
-std::vector<Translator::OptionDescription> Frame::Options() {
+std::vector<Translator::OptionDescription> Frame::Options() const {
   return {
       {
           "ascii_only",
@@ -65,17 +71,17 @@ std::vector<Translator::Example> Frame::Examples() {
 }
 
 std::string Frame::Translate(const std::string& input,
+                             const OptionSet& options) const {
+  std::string output;
+  TranslateTo(input, options, StringSink(&output).get());
+  return output;
+}
 
-                             const std::string& options_string) {
-  auto options = SerializeOption(options_string);
-
-  bool ascii_only = false;
-  if (options.count("ascii_only") && options.at("ascii_only") == "true")
-    ascii_only = true;
-
-  bool line_number = true;
-  if (options.count("line_number") && options.at("line_number") == "false")
-    line_number = false;
+void Frame::TranslateTo(const std::string& input,
+                        const OptionSet& options,
+                        Sink* sink) const {
+  bool ascii_only = options.GetBool("ascii_only");
+  bool line_number = options.GetBool("line_number");
 
   // cut by lines.
   std::stringstream ss(input);
@@ -109,42 +115,44 @@ std::string Frame::Translate(const std::string& input,
   }
   int text_y = ascii_only ? 2 : 1;
 
-  Screen screen(width, height);
+  DrawList draw_list;
 
   // Draw text.
   for (int y = 0; y < lines.size(); ++y) {
-    screen.DrawText(text_x, text_y + y, lines[y]);
+    draw_list.DrawText(text_x, text_y + y, lines[y]);
   }
 
   // Draw line number.
   if (line_number) {
     for (int y = 0; y < lines.size(); ++y) {
-      screen.DrawText(1, text_y + y, to_wstring(std::to_string(y + 1)));
+      draw_list.DrawText(1, text_y + y, to_wstring(std::to_string(y + 1)));
     }
   }
 
   // Draw box.
   if (ascii_only) {
-    screen.DrawHorizontalLine(1, width - 2, 0, L'_');
-    screen.DrawHorizontalLine(1, width - 2, height - 1, L'_');
-    screen.DrawVerticalLine(1, height - 1, 0);
-    screen.DrawVerticalLine(1, height - 1, width - 1);
+    draw_list.DrawHorizontalLine(1, width - 2, 0, L'_');
+    draw_list.DrawHorizontalLine(1, width - 2, height - 1, L'_');
+    draw_list.DrawVerticalLine(1, height - 1, 0);
+    draw_list.DrawVerticalLine(1, height - 1, width - 1);
   } else {
-    screen.DrawBox(0, 0, width, height);
+    draw_list.DrawBox(0, 0, width, height);
   }
 
   // Draw the line number separator.
   if (line_number) {
     if (ascii_only) {
-      screen.DrawVerticalLine(1, height - 1, number_length + 1, L'|');
+      draw_list.DrawVerticalLine(1, height - 1, number_length + 1, L'|');
     } else {
-      screen.DrawPixel(number_length + 1, 0, L'┬');
-      screen.DrawVerticalLine(1, height - 1, number_length + 1);
-      screen.DrawPixel(number_length + 1, height - 1, L'┴');
+      draw_list.DrawPixel(number_length + 1, 0, L'┬');
+      draw_list.DrawVerticalLine(1, height - 1, number_length + 1);
+      draw_list.DrawPixel(number_length + 1, height - 1, L'┴');
     }
   }
 
-  return screen.ToString();
+  Screen screen(width, height);
+  draw_list.Replay(&screen);
+  InternedRows(screen).Write(sink);
 }
 
 std::unique_ptr<Translator> FrameTranslator() {
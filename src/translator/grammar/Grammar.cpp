@@ -2,17 +2,19 @@
 // Use of this source code is governed by the MIT license that can be found in
 // the LICENSE file.
 
-#include <fstream>
-#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+#include "translator/Diagnostics.h"
 #include "translator/Translator.h"
+#include "translator/grammar/KgtOutput.h"
 
 #ifndef _WIN32
 
-#include <unistd.h>
-
 namespace kgt {
 extern "C" {
 int debug = 0;
@@ -56,13 +58,13 @@ using OpaqueRead = int(Opaque);
 using InputFunction = AstRulePtr(OpaqueRead, Opaque, kgt::parsing_error_queue*);
 using OutputFunction = int(const struct kgt::ast_rule*);
 
-std::map<std::string, InputFunction*> input_function_map = {
+const std::map<std::string, InputFunction*> input_function_map = {
     {"abnf", kgt::abnf_input},         {"bnf", kgt::bnf_input},
     {"iso-ebnf", kgt::iso_ebnf_input}, {"rbnf", kgt::rbnf_input},
     {"wsn", kgt::wsn_input},
 };
 
-std::map<std::string, OutputFunction*> output_function_map = {
+const std::map<std::string, OutputFunction*> output_function_map = {
     {"ascii", kgt::rrtext_output},
     {"unicode", kgt::rrutf8_output},
 
@@ -102,13 +104,13 @@ class Grammar : public Translator {
   const char* Description() final {
     return "Railroad diagram from grammar descriptions";
   }
-  std::vector<Translator::OptionDescription> Options() final;
+  std::vector<Translator::OptionDescription> Options() const final;
   std::vector<Translator::Example> Examples() final;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) final;
+                        const OptionSet& options) const final;
 };
 
-std::vector<Translator::OptionDescription> Grammar::Options() {
+std::vector<Translator::OptionDescription> Grammar::Options() const {
   return {
       {
           "input",
@@ -271,53 +273,56 @@ LITERAL    = """" character { character } """" .
 
 #ifndef _WIN32
 std::string Grammar::Translate(const std::string& input,
-                               const std::string& options_string) {
-  // Duplicate stdout, so that we can restore it later.
-  int old_stdout = dup(1);
-
-  // Redirect stdout to file.
-  FILE* file_write = fopen("/tmp/diagon_grammer.txt", "w");
-  dup2(fileno(file_write), 1);
-
-  // Read string to model.
-  auto string_reader = StringReader(input);
-
-  auto options = SerializeOption(options_string);
-
-  std::string option_input = options["input"];
-  std::string option_output = options["output"];
-
-  auto input_function = input_function_map.count(option_input)
-                            ? input_function_map[option_input]
-                            : kgt::abnf_input;
-  auto output_function = output_function_map.count(option_output)
-                             ? output_function_map[option_output]
-                             : kgt::rrutf8_output;
-
-  kgt::parsing_error_queue parsing_errors = NULL;
-  auto* model =
-      input_function(StringReader::Read, &string_reader, &parsing_errors);
-
-  while (parsing_errors) {
-    kgt::parsing_error error;
-    parsing_error_queue_pop(&parsing_errors, &error);
-    std::cout << error.line << ":" << error.col << ":" << error.description
-              << std::endl;
+                               const OptionSet& options) const {
+  // kgt writes to the stream of the current thread, see KgtOutput.h. Its
+  // calls are still serialized: it isn't written to be reentrant.
+  static std::mutex kgt_mutex;
+  std::lock_guard<std::mutex> lock(kgt_mutex);
+
+  char* buffer = nullptr;
+  size_t size = 0;
+  FILE* file = open_memstream(&buffer, &size);
+  if (!file)
+    return "";
+  {
+    ScopedKgtOutput scoped_output(file);
+
+    // Read string to model.
+    auto string_reader = StringReader(input);
+
+    const std::string& option_input = options.Get("input");
+    const std::string& option_output = options.Get("output");
+
+    auto input_function = input_function_map.count(option_input)
+                              ? input_function_map.at(option_input)
+                              : kgt::abnf_input;
+    auto output_function = output_function_map.count(option_output)
+                               ? output_function_map.at(option_output)
+                               : kgt::rrutf8_output;
+
+    kgt::parsing_error_queue parsing_errors = NULL;
+    auto* model =
+        input_function(StringReader::Read, &string_reader, &parsing_errors);
+
+    while (parsing_errors) {
+      kgt::parsing_error error;
+      parsing_error_queue_pop(&parsing_errors, &error);
+      ReportDiagnostic({"grammar-parse-error", size_t(error.line),
+                        size_t(error.col), error.description});
+    }
+
+    int error = output_function(model);
+    (void)error;
   }
 
-  int error = output_function(model);
-  (void)error;
-  dup2(old_stdout, 1);
-  close(old_stdout);
-  fclose(file_write);
-
-  auto file_read = std::ifstream("/tmp/diagon_grammer.txt");
-  return std::string((std::istreambuf_iterator<char>(file_read)),
-                     std::istreambuf_iterator<char>());
+  fclose(file);
+  std::string output(buffer, size);
+  free(buffer);
+  return output;
 }
 #else
 std::string Grammar::Translate(const std::string& input,
-                               const std::string& options_string) {
+                               const OptionSet& options) const {
   return "Not supported on Windows";
 }
 #endif
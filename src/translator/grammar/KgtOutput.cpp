@@ -0,0 +1,46 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+#include "translator/grammar/KgtOutput.h"
+
+namespace {
+
+thread_local FILE* g_output = nullptr;
+
+}  // namespace
+
+ScopedKgtOutput::ScopedKgtOutput(FILE* file) : previous_(g_output) {
+  g_output = file;
+}
+
+ScopedKgtOutput::~ScopedKgtOutput() {
+  g_output = previous_;
+}
+
+FILE* kgt_stdout(void) {
+  return g_output ? g_output : stdout;
+}
+
+int kgt_printf(const char* format, ...) {
+  va_list arguments;
+  va_start(arguments, format);
+  int result = vfprintf(kgt_stdout(), format, arguments);
+  va_end(arguments);
+  return result;
+}
+
+int kgt_vprintf(const char* format, va_list arguments) {
+  return vfprintf(kgt_stdout(), format, arguments);
+}
+
+int kgt_puts(const char* string) {
+  FILE* file = kgt_stdout();
+  if (fputs(string, file) == EOF)
+    return EOF;
+  return fputc('\n', file);
+}
+
+int kgt_putchar(int c) {
+  return fputc(c, kgt_stdout());
+}
@@ -0,0 +1,57 @@
+#ifndef TRANSLATOR_GRAMMAR_KGT_OUTPUT
+#define TRANSLATOR_GRAMMAR_KGT_OUTPUT
+
+/* kgt writes its output to stdout. Its sources are compiled with this header
+ * included first and DIAGON_KGT_OUTPUT defined (see CMakeLists.txt), which
+ * sends their writes to |kgt_stdout()| instead: the stream installed by a
+ * |ScopedKgtOutput| on the current thread, or stdout without one.
+ *
+ * The process-wide stdout is never modified, so the other threads writing to
+ * it are not affected. */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FILE* kgt_stdout(void);
+int kgt_printf(const char* format, ...);
+int kgt_vprintf(const char* format, va_list arguments);
+int kgt_puts(const char* string);
+int kgt_putchar(int c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(DIAGON_KGT_OUTPUT) && !defined(__cplusplus)
+#undef stdout
+#define stdout (kgt_stdout())
+#undef printf
+#define printf kgt_printf
+#undef vprintf
+#define vprintf kgt_vprintf
+#undef puts
+#define puts kgt_puts
+#undef putchar
+#define putchar kgt_putchar
+#endif
+
+#ifdef __cplusplus
+/* Makes the kgt functions called by the current thread write to |file|, while
+ * in scope. Scopes can be nested. */
+class ScopedKgtOutput {
+ public:
+  explicit ScopedKgtOutput(FILE* file);
+  ~ScopedKgtOutput();
+  ScopedKgtOutput(const ScopedKgtOutput&) = delete;
+  ScopedKgtOutput& operator=(const ScopedKgtOutput&) = delete;
+
+ private:
+  FILE* previous_;
+};
+#endif
+
+#endif /* end of include guard: TRANSLATOR_GRAMMAR_KGT_OUTPUT */
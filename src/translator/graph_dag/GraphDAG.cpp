@@ -1,9 +1,10 @@
 #include <memory>
 #include <vector>
 
+#include "screen/Sink.h"
 #include "translator/Translator.h"
 
-std::string DagToText(const std::string& input);
+std::unique_ptr<TranslationLayout> DagToLayout(const std::string& input);
 
 class GraphDAG : public Translator {
  public:
@@ -13,13 +14,19 @@ class GraphDAG : public Translator {
   const char* Description() final {
     return "Draw a graph, specialized for Directed Acyclic ones";
   }
-  std::vector<Translator::OptionDescription> Options() final;
+  std::vector<Translator::OptionDescription> Options() const final;
   std::vector<Translator::Example> Examples() final;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) final;
+                        const OptionSet& options) const final;
+  void TranslateTo(const std::string& input,
+                   const OptionSet& options,
+                   Sink* sink) const final;
+  std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const final;
 };
 
-std::vector<Translator::OptionDescription> GraphDAG::Options() {
+std::vector<Translator::OptionDescription> GraphDAG::Options() const {
   return {};
 }
 
@@ -87,8 +94,22 @@ std::vector<Translator::Example> GraphDAG::Examples() {
 }
 
 std::string GraphDAG::Translate(const std::string& input,
-                                const std::string& options_string) {
-  return DagToText(input);
+                                const OptionSet& options) const {
+  std::string output;
+  TranslateTo(input, options, StringSink(&output).get());
+  return output;
+}
+
+void GraphDAG::TranslateTo(const std::string& input,
+                           const OptionSet& options,
+                           Sink* sink) const {
+  ComputeLayout(input, options)->Rasterize(options, sink);
+}
+
+std::unique_ptr<TranslationLayout> GraphDAG::ComputeLayout(
+    const std::string& input,
+    const OptionSet& options) const {
+  return DagToLayout(input);
 }
 
 std::unique_ptr<Translator> GraphDAGTranslator() {
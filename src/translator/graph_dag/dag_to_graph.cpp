@@ -1,27 +1,56 @@
 #include <algorithm>
 #include <map>
+#include <memory_resource>
 #include <queue>
 #include <set>
 #include <string>
 #include <string_view>
 #include <vector>
+#include "screen/Connection.h"
+#include "screen/Scene.h"
 #include "screen/Screen.h"
+#include "screen/Sink.h"
+#include "translator/Arena.h"
+#include "translator/Budget.h"
+#include "translator/Translator.h"
 
 namespace {
 
+// Allocated from the |TranslationMemory()|. The containers use the allocator
+// of the vector holding the node.
 struct Node {
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  explicit Node(const allocator_type& allocator = TranslationMemory())
+      : upward(allocator),
+        downward(allocator),
+        downward_closure(allocator),
+        upward_sorted(allocator),
+        downward_sorted(allocator) {}
+  Node(const Node& other, const allocator_type& allocator)
+      : Node(allocator) {
+    *this = other;
+  }
+  Node(Node&& other, const allocator_type& allocator) : Node(allocator) {
+    *this = std::move(other);
+  }
+  Node(const Node&) = default;
+  Node(Node&&) = default;
+  Node& operator=(const Node&) = default;
+  Node& operator=(Node&&) = default;
+
   // Parsing:
-  std::set<int> upward;
-  std::set<int> downward;
+  std::pmr::set<int> upward;
+  std::pmr::set<int> downward;
   bool is_connector = false;
   bool padding = 1;
 
   // Layering:
   int layer = 0;
   int row = 0;
-  std::set<int> downward_closure;
-  std::vector<int> upward_sorted;
-  std::vector<int> downward_sorted;
+  std::pmr::set<int> downward_closure;
+  std::pmr::vector<int> upward_sorted;
+  std::pmr::vector<int> downward_sorted;
 
   // Rendering:
   int width = 0;
@@ -49,7 +78,7 @@ struct Adapter {
   std::vector<std::set<int>> outputs;
 
   void Construct();
-  void Render(Screen& screen);
+  void Render(Scene& scene);
   int height = 0;
 
   int y = 0;
@@ -64,6 +93,22 @@ struct Layer {
   Adapter adapter;
 };
 
+// The drawing of a graph, or the reason it couldn't be drawn.
+class DagLayout : public TranslationLayout {
+ public:
+  void Rasterize(const OptionSet& options, Sink* sink) const override {
+    if (!error.empty()) {
+      sink->Write(error);
+      return;
+    }
+    // The canvas can get large, and uses few distinct glyphs.
+    scene.Rasterize(Screen::Storage::Compact).Write(sink);
+  }
+
+  Scene scene;
+  std::string error;
+};
+
 struct Context {
   // Node "label" toward Node's "ID".
   std::vector<std::wstring> labels;
@@ -71,12 +116,12 @@ struct Context {
   // Node "ID" toward Node's "label".
   std::map<std::wstring, int> id;
 
-  std::vector<Node> nodes;
+  std::pmr::vector<Node> nodes{TranslationMemory()};
 
   std::vector<Layer> layers;
 
   // --------------------------------------------
-  std::string Process(const std::wstring& input);
+  void Process(const std::wstring& input, DagLayout* layout);
   void Parse(const std::wstring& input);
   void AddNode(std::wstring name);
   void AddConnector(int a, int b);
@@ -92,7 +137,7 @@ struct Context {
   bool LayoutGrowNode();
   bool LayoutShiftEdges();
   bool LayoutShiftConnectorNode();
-  std::string Render();
+  void Render(Scene* scene);
 };
 
 void Context::AddNode(std::wstring name) {
@@ -136,6 +181,7 @@ bool Context::Toposort() {
   bool has_work = true;
   int iteration = 0;
   while (has_work) {
+    BudgetStep(nodes.size());
     has_work = false;
     for (int a = 0; a < nodes.size(); ++a) {
       for (const auto& b : nodes[a].downward) {
@@ -203,6 +249,7 @@ void Context::Parse(const std::wstring& input) {
 void Context::Complete() {
   bool work_to_do = true;
   while (work_to_do) {
+    BudgetStep(nodes.size());
     work_to_do = false;
     for (int a = 0; a < nodes.size(); ++a) {
       for (int b : nodes[a].downward) {
@@ -319,7 +366,8 @@ void Context::OptimizeRowOrder() {
     float score_last_loop = 0.f;
     while (score != score_last_loop) {
       score_last_loop = score;
-      for (int a = 0; a < layer_width; ++a)
+      for (int a = 0; a < layer_width; ++a) {
+        BudgetStep(layer_width * layer_width);
         for (int b = 0; b < layer_width; ++b) {
           std::swap(permutation[a], permutation[b]);
           float new_score = evaluate_score();
@@ -329,6 +377,7 @@ void Context::OptimizeRowOrder() {
             std::swap(permutation[a], permutation[b]);
           }
         }
+      }
     }
 
     // Reorder the nodes inside the layer.
@@ -398,6 +447,7 @@ void Context::Layout() {
 
   // x-axis: increase size, so that nodes and connectors fit together.
   for (int i = 0; i < 1000; ++i) {
+    BudgetStep(nodes.size());
     if (!LayoutNodeDoNotTouch())
       continue;
     if (!LayoutEdgesDoNotTouch())
@@ -584,10 +634,19 @@ void Adapter::Construct() {
 
   struct Edge;
 
+  // Allocated from the |TranslationMemory()|, and rebuilt for every height
+  // attempted below.
   struct Node {
-    bool visited;
-    int cost;
-    std::vector<Edge*> edges;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+    explicit Node(const allocator_type& allocator) : edges(allocator) {}
+    Node(const Node& other, const allocator_type& allocator)
+        : visited(other.visited),
+          cost(other.cost),
+          edges(other.edges, allocator) {}
+
+    bool visited = false;
+    int cost = 0;
+    std::pmr::vector<Edge*> edges;
   };
 
   struct Edge {
@@ -597,8 +656,8 @@ void Adapter::Construct() {
     int assigned = 0;
   };
 
-  std::vector<Node> nodes;
-  std::vector<Edge> edges;
+  std::pmr::vector<Node> nodes(TranslationMemory());
+  std::pmr::vector<Edge> edges(TranslationMemory());
 
   height = 3;
   bool solution_found = false;
@@ -658,6 +717,7 @@ void Adapter::Construct() {
 
     // Add path one by one.
     for (int connector = 1; connector <= connector_length; ++connector) {
+      BudgetStep(nodes.size());  // The shortest path search below.
       int big_number = 1 << 15;
 
       // Clear:
@@ -757,24 +817,24 @@ void Adapter::Construct() {
         height, std::vector<wchar_t>(width, L' '));
     for (int y = 0; y < height; ++y) {
       for (int x = 0; x < width; ++x) {
-        wchar_t& v = rendering[y][x];
+        // Vertical edges are drawn over the horizontal ones they cross.
+        int mask = 0;
         if (assigned(x, y, 1))
-          v = L'─';
+          mask = kLeft | kRight;
         if (assigned(x, y, 0))
-          v = L'│';
+          mask = kUp | kDown;
         if (assigned(x, y, 2)) {
-          if (assigned(x, y, 0))
-            v = assigned(x, y, 1) ? L'┌' : L'┐';
-          else
-            v = assigned(x, y, 1) ? L'└' : L'┘';
+          mask = (assigned(x, y, 0) ? kDown : kUp) |
+                 (assigned(x, y, 1) ? kRight : kLeft);
         }
+        rendering[y][x] = ConnectionGlyph(mask);
       }
     }
     return;
   }
 }
 
-void Adapter::Render(Screen& screen) {
+void Adapter::Render(Scene& scene) {
   for (int dy = 0; dy < height - 1; ++dy) {
     int x = 0;
     for (auto value : rendering[dy]) {
@@ -783,30 +843,26 @@ void Adapter::Render(Screen& screen) {
         continue;
       }
 
-      auto& pixel = screen.Pixel(x, y + dy);
-
       if (dy == 0) {
-        if (pixel == L'─')
-          pixel = L'┬';
+        scene.Connect(x, y + dy, kDown);
         ++x;
         continue;
       }
 
       if (dy == height - 2) {
-        if (pixel == L'─')
-          pixel = L'▽';
+        scene.DrawArrowHead(x, y + dy);
         ++x;
         continue;
       }
 
-      pixel = value;
+      scene.DrawPixel(x, y + dy, value);
       ++x;
       continue;
     }
   }
 }
 
-std::string Context::Render() {
+void Context::Render(Scene* scene) {
   int width = 0;
   int height = 0;
   for (const Node& node : nodes) {
@@ -814,60 +870,68 @@ std::string Context::Render() {
     height = std::max(height, node.y + node.height);
   }
 
+  // The nodes are drawn below the edges, which connect to their borders.
+  scene->Resize(width, height);
+
   // Draw the nodes.
-  auto screen = Screen(width, height);
+  scene->Layer(0);
   for (int i = 0; i < nodes.size(); ++i) {
     const Node& node = nodes[i];
     if (node.is_connector) {
       if (node.width == 1)
-        screen.DrawVerticalLine(node.y, node.y + 2, node.x);
+        scene->DrawVerticalLine(node.y, node.y + 2, node.x);
       else
-        screen.DrawBox(node.x, node.y, node.width, node.height);
+        scene->DrawBox(node.x, node.y, node.width, node.height);
     } else {
-      screen.DrawBox(node.x, node.y, node.width, node.height);
-      screen.DrawText(node.x + 1, node.y + 1, labels[i]);
+      scene->DrawBox(node.x, node.y, node.width, node.height);
+      scene->DrawText(node.x + 1, node.y + 1, labels[i]);
     }
   }
 
   // Draw the edges.
+  scene->Layer(1);
   for (int y = 0; y < layers.size(); ++y) {
     auto& layer = layers[y];
     for (Edge& edge : layer.edges) {
       wchar_t up = nodes[edge.up].is_connector ? L'│' : L'┬';
       wchar_t down = nodes[edge.down].is_connector ? L'│' : L'▽';
-      screen.DrawPixel(edge.x, edge.y + 0, up);
-      screen.DrawPixel(edge.x, edge.y + 1, down);
+      scene->DrawPixel(edge.x, edge.y + 0, up);
+      scene->DrawPixel(edge.x, edge.y + 1, down);
     }
   }
 
-  // Draw the adapters:
+  // Draw the adapters. They merge with the cells drawn above, so they are
+  // drawn over the composited layers.
+  scene->Flatten();
   for (int y = 0; y < layers.size(); ++y) {
     auto& layer = layers[y];
     if (layer.adapter.enabled)
-      layer.adapter.Render(screen);
+      layer.adapter.Render(*scene);
   }
-
-  return screen.ToString();
 }
 
-std::string Context::Process(const std::wstring& input) {
+void Context::Process(const std::wstring& input, DagLayout* layout) {
   Parse(input.c_str());
   if (nodes.size() == 0)
-    return "";
-  if (!Toposort())
-    return "There are cycles";
+    return;
+  if (!Toposort()) {
+    layout->error = "There are cycles";
+    return;
+  }
   Complete();
   AddToLayers();
   ResolveCrossingEdges();
   Layout();
-  return Render();
+  Render(&layout->scene);
 }
 
 }  // namespace
 
-std::string DagToText(const std::string& input) {
+std::unique_ptr<TranslationLayout> DagToLayout(const std::string& input) {
+  auto layout = std::make_unique<DagLayout>();
   Context context;
-  return context.Process(to_wstring(input));
+  context.Process(to_wstring(input), layout.get());
+  return layout;
 }
 
 // Copyright 2020 Arthur Sonzogni. All rights reserved.
@@ -7,7 +7,9 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include "screen/Scene.h"
 #include "screen/Screen.h"
+#include "screen/Sink.h"
 #include "translator/Translator.h"
 #include "translator/antlr_error_listener.h"
 #include "translator/graph_planar/GraphPlanarLexer.h"
@@ -56,6 +58,25 @@ struct Box {
 
 class GraphPlanar;
 
+// The drawing of a graph, or the reason it couldn't be drawn.
+class GraphPlanarLayout : public TranslationLayout {
+ public:
+  void Rasterize(const OptionSet& options, Sink* sink) const override {
+    if (!error.empty()) {
+      sink->Write(error);
+      return;
+    }
+    // The planar drawing is mostly blank.
+    Screen screen = scene.Rasterize(Screen::Storage::Sparse);
+    if (options.GetBool("ascii_only"))
+      screen.ASCIIfy(1);
+    screen.Write(sink);
+  }
+
+  Scene scene;
+  std::string error;
+};
+
 struct DrawnEdge {
   int x;
   int vertex_up;
@@ -63,7 +84,7 @@ struct DrawnEdge {
   int y_up;
   int y_down;
 
-  void Draw(Screen& screen, GraphPlanar& graph);
+  void Draw(Scene& scene, GraphPlanar& graph);
 };
 
 struct DrawnVertex {
@@ -73,7 +94,7 @@ struct DrawnVertex {
   std::wstring text;
   std::vector<DrawnEdge> edges;
 
-  void Draw(Screen& screen);
+  void Draw(Scene& scene);
 };
 
 enum class Arrow {
@@ -111,12 +132,18 @@ class GraphPlanar : public Translator {
   const char* Description() final {
     return "Build a graph from node and edges";
   }
-  std::vector<Translator::OptionDescription> Options() final;
+  std::vector<Translator::OptionDescription> Options() const final;
   std::vector<Translator::Example> Examples() final;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) final;
+                        const OptionSet& options) const final;
+  std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const final;
   std::string Highlight(const std::string& input) final;
 
+  // Same as |ComputeLayout|, storing the translation state in |this|, which
+  // must be freshly constructed.
+  std::unique_ptr<TranslationLayout> Process(const std::string& input);
   void Read(const std::string& input);
   void ReadGraph(GraphPlanarParser::GraphContext* graph);
   void ReadEdges(GraphPlanarParser::EdgesContext* edges);
@@ -126,8 +153,9 @@ class GraphPlanar : public Translator {
   void Write();
   void ComputeArrowStyle();
 
-  bool ascii_only_;
-  std::string output_;
+  // The drawing, or the reason the graph couldn't be drawn.
+  Scene scene_;
+  std::string error_;
 
   std::map<std::wstring, int> name_to_id;
   std::vector<std::wstring> id_to_name;
@@ -136,7 +164,7 @@ class GraphPlanar : public Translator {
   std::vector<Edge> vertex_;
 };
 
-std::vector<Translator::OptionDescription> GraphPlanar::Options() {
+std::vector<Translator::OptionDescription> GraphPlanar::Options() const {
   return {
       {
           "ascii_only",
@@ -147,6 +175,7 @@ std::vector<Translator::OptionDescription> GraphPlanar::Options() {
           "false",
           "Use the full unicode charset or only ASCII.",
           Widget::Checkbox,
+          /*style=*/true,
       },
   };
 }
@@ -171,17 +200,35 @@ std::vector<Translator::Example> GraphPlanar::Examples() {
 }
 
 std::string GraphPlanar::Translate(const std::string& input,
-                                   const std::string& options_string) {
-  *this = GraphPlanar();
-  auto options = SerializeOption(options_string);
-  ascii_only_ = (options["ascii_only"] == "true");
+                                   const OptionSet& options) const {
+  std::string output;
+  ComputeLayout(input, options)->Rasterize(options, StringSink(&output).get());
+  return output;
+}
+
+std::unique_ptr<TranslationLayout> GraphPlanar::ComputeLayout(
+    const std::string& input,
+    const OptionSet& options) const {
+  // The translation state lives in a fresh GraphPlanar, so that this one stays
+  // untouched and can be shared between threads.
+  GraphPlanar graph;
+  return graph.Process(input);
+}
 
+std::unique_ptr<TranslationLayout> GraphPlanar::Process(
+    const std::string& input) {
   Read(input);
   Write();
-  return output_;
+
+  auto layout = std::make_unique<GraphPlanarLayout>();
+  layout->scene = std::move(scene_);
+  layout->error = std::move(error_);
+  return layout;
 }
 
 void GraphPlanar::Read(const std::string& input) {
+  // Lexers and parsers share caches. See |AntlrMutex|.
+  std::unique_lock<std::mutex> lock(AntlrMutex());
   antlr4::ANTLRInputStream input_stream(input);
 
   // Lexer.
@@ -199,6 +246,7 @@ void GraphPlanar::Read(const std::string& input) {
   } catch (...) {
     return;
   }
+  lock.unlock();
 
   ReadGraph(context);
 }
@@ -305,7 +353,7 @@ void GraphPlanar::Write() {
   ComputeArrowStyle();
 
   if (id_to_name.size() <= 2) {
-    output_ = "Graph contains less than 3 edges.\n";
+    error_ = "Graph contains less than 3 edges.\n";
     return;
   }
 
@@ -354,7 +402,7 @@ void GraphPlanar::Write() {
   auto embedding = EdgePermutation(embedding_storage.begin(), vertex_index);
   const bool is_planar_1 = PlanarEmbedding(graph, embedding_storage, embedding);
   if (!is_planar_1) {
-    output_ = "Graph is not planar.\n";
+    error_ = "Graph is not planar.\n";
     return;
   }
 
@@ -512,51 +560,49 @@ void GraphPlanar::Write() {
     height = std::max(height, 3 * drawn_vertices[i].y + 3);
   }
 
-  Screen screen(width, height);
+  scene_.Resize(width, height);
   for (int i = 0; i < num_vertices; ++i) {
     if (!is_drawn[i])
       continue;
-    drawn_vertices[i].Draw(screen);
+    drawn_vertices[i].Draw(scene_);
   }
   for (int i = 0; i < num_vertices; ++i) {
     if (!is_drawn[i])
       continue;
     for (auto& edge : drawn_vertices[i].edges) {
-      edge.Draw(screen, *this);
+      edge.Draw(scene_, *this);
     }
   }
-
-  if (ascii_only_)
-    screen.ASCIIfy(1);
-  output_ += screen.ToString();
 }
 
-void DrawnVertex::Draw(Screen& screen) {
-  screen.DrawBox(left, 3 * y, right - left + 1, 3);
+void DrawnVertex::Draw(Scene& scene) {
+  scene.DrawBox(left, 3 * y, right - left + 1, 3);
   int text_position = left + 1 + (right - left - 1 - text.size()) / 2;
-  screen.DrawText(text_position, 3 * y + 1, text);
+  scene.DrawText(text_position, 3 * y + 1, text);
 }
 
-void DrawnEdge::Draw(Screen& screen, GraphPlanar& graph) {
+void DrawnEdge::Draw(Scene& scene, GraphPlanar& graph) {
   int top = 3 * y_up - 1;
   int bottom = 3 * y_down + 3;
 
-  screen.DrawVerticalLine(top + 1, bottom - 1, x);
+  scene.DrawVerticalLine(top + 1, bottom - 1, x);
 
   if (graph.arrow_style[vertex_down][vertex_up] == ArrowStyle::LINE)
-    screen.DrawPixel(x, top, L'┬');
+    scene.DrawPixel(x, top, L'┬');
   else
-    screen.DrawPixel(x, top, L'△');
+    scene.DrawPixel(x, top, L'△');
 
   if (graph.arrow_style[vertex_up][vertex_down] == ArrowStyle::LINE)
-    screen.DrawPixel(x, bottom, L'┴');
+    scene.DrawPixel(x, bottom, L'┴');
   else
-    screen.DrawPixel(x, bottom, L'▽');
+    scene.DrawPixel(x, bottom, L'▽');
 }
 
 std::string GraphPlanar::Highlight(const std::string& input) {
   std::stringstream out;
 
+  // Lexers and parsers share caches. See |AntlrMutex|.
+  std::lock_guard<std::mutex> lock(AntlrMutex());
   antlr4::ANTLRInputStream input_stream(input);
 
   // Lexer.
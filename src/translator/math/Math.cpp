@@ -2,9 +2,16 @@
 // Use of this source code is governed by the MIT license that can be found in
 // the LICENSE file.
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include "screen/Screen.h"
+#include "screen/Sink.h"
+#include "translator/Arena.h"
+#include "translator/Diagnostics.h"
 #include "translator/Translator.h"
 #include "translator/antlr_error_listener.h"
 #include "translator/math/MathLexer.h"
@@ -17,10 +24,15 @@ struct Draw {
   int dim_y = 0;
   int center_x = 0;
   int center_y = 0;
-  std::vector<std::vector<wchar_t>> content;
+  // Allocated from the translation arena, when there is one.
+  std::pmr::vector<std::pmr::vector<wchar_t>> content;
 
-  Draw() = default;
+  Draw() : content(TranslationMemory()) {}
   Draw(const std::wstring text);
+  Draw(const Draw& other) : Draw() { *this = other; }
+  Draw(Draw&&) = default;
+  Draw& operator=(const Draw&) = default;
+  Draw& operator=(Draw&&) = default;
   void Append(const Draw& other, int x, int y);
   void Resize(int dim_x, int dim_y);
 };
@@ -104,7 +116,7 @@ std::wstring ParseLatex(MathParser::AtomContext*,
                         bool suppress_parenthesis);
 std::wstring ParseLatex(MathParser::VariableContext*, Style*);
 
-Draw::Draw(const std::wstring text) {
+Draw::Draw(const std::wstring text) : Draw() {
   content.resize(1);
   for (const auto& c : text) {
     content[0].push_back(c);
@@ -121,19 +133,21 @@ void Draw::Append(const Draw& other, int x, int y) {
 
   // Write
   for (size_t dy = 0; dy < other.dim_y; ++dy) {
-    for (size_t dx = 0; dx < other.dim_x; ++dx) {
-      content[y + dy][x + dx] = other.content[dy][dx];
-    }
+    const auto& line = other.content[dy];
+    std::copy(line.begin(), line.begin() + other.dim_x,
+              content[y + dy].begin() + x);
   }
 }
 
 void Draw::Resize(int new_dim_x, int new_dim_y) {
+  // Only the new lines need to be widened when the width is unchanged.
+  size_t first_line = (new_dim_x == dim_x) ? content.size() : 0;
   dim_x = new_dim_x;
   dim_y = new_dim_y;
 
   content.resize(dim_y);
-  for (auto& line : content) {
-    line.resize(dim_x, L' ');
+  for (size_t y = first_line; y < content.size(); ++y) {
+    content[y].resize(dim_x, L' ');
   }
 }
 
@@ -456,11 +470,24 @@ std::wstring ParseLatex(MathParser::ValueBangContext* context,
     return ParseLatex(context->valueBang(), style, suppress_parenthesis) + L"!";
 }
 
+// Reports the wrong number of arguments given to the function of |context|.
+void ReportArguments(MathParser::FunctionContext* context,
+                     const std::string& message) {
+  antlr4::Token* start = context->getStart();
+  ReportDiagnostic({
+      "math-function-arguments",
+      start->getLine(),
+      start->getCharPositionInLine() + 1,
+      message,
+  });
+}
+
 bool CheckFunctionSqrt(MathParser::FunctionContext* context) {
   int num_arguments = context->equation().size();
   if (num_arguments != 1) {
-    std::cerr << "Square root function (sqrt) only handle one argument, "
-              << num_arguments << " provided" << std::endl;
+    ReportArguments(context,
+                    "Square root function (sqrt) only handle one argument, " +
+                        std::to_string(num_arguments) + " provided");
     return false;
   }
   return true;
@@ -486,8 +513,9 @@ Draw ParseFunctionSqrt(MathParser::FunctionContext* context, Style* style) {
 bool CheckFunctionSum(MathParser::FunctionContext* context) {
   int num_arguments = context->equation().size();
   if (num_arguments > 3) {
-    std::cerr << "Summation function (sum) only handle 1,2 or 3 arguments, "
-              << num_arguments << " provided" << std::endl;
+    ReportArguments(
+        context, "Summation function (sum) only handle 1,2 or 3 arguments, " +
+                     std::to_string(num_arguments) + " provided");
     return false;
   }
   return true;
@@ -554,8 +582,9 @@ std::wstring ParseFunctionSumLatex(MathParser::FunctionContext* context,
 bool CheckFunctionLimit(MathParser::FunctionContext* context) {
   int num_arguments = context->equation().size();
   if (num_arguments != 2) {
-    std::cerr << "Limit function (lim) only handle 2 arguments, but "
-              << num_arguments << " provided" << std::endl;
+    ReportArguments(context,
+                    "Limit function (lim) only handle 2 arguments, but " +
+                        std::to_string(num_arguments) + " provided");
     return false;
   }
   return true;
@@ -605,9 +634,10 @@ std::wstring ParseFunctionLimitLatex(MathParser::FunctionContext* context,
 bool CheckFunctionMult(MathParser::FunctionContext* context) {
   int num_arguments = context->equation().size();
   if (num_arguments > 3) {
-    std::cerr
-        << "Multiplication function (mult) only handle 1,2 or 3 arguments, "
-        << num_arguments << " provided" << std::endl;
+    ReportArguments(
+        context,
+        "Multiplication function (mult) only handle 1,2 or 3 arguments, " +
+            std::to_string(num_arguments) + " provided");
     return false;
   }
   return true;
@@ -764,8 +794,9 @@ std::wstring ParseFunctionMathBBLatex(MathParser::FunctionContext* context,
 bool CheckFunctionIntegral(MathParser::FunctionContext* context) {
   int num_arguments = context->equation().size();
   if (num_arguments > 3) {
-    std::cerr << "Integral function (int) only handle 1,2 or 3 arguments, "
-              << num_arguments << " provided" << std::endl;
+    ReportArguments(
+        context, "Integral function (int) only handle 1,2 or 3 arguments, " +
+                     std::to_string(num_arguments) + " provided");
     return false;
   }
 
@@ -787,10 +818,14 @@ Draw ParseFunctionIntegral(MathParser::FunctionContext* context, Style* style) {
   Draw integral;
   integral.Resize(integral_width, integral_height);
 
-  integral.content.front() = style->integral_top;
-  integral.content.back() = style->integral_bottom;
+  auto assign = [](std::pmr::vector<wchar_t>& line,
+                   const std::vector<wchar_t>& value) {
+    line.assign(value.begin(), value.end());
+  };
+  assign(integral.content.front(), style->integral_top);
+  assign(integral.content.back(), style->integral_bottom);
   for (int y = 1; y < integral.content.size() - 1; ++y)
-    integral.content[y] = style->integral_middle;
+    assign(integral.content[y], style->integral_middle);
 
   // Align top, integral, and bottom on center.
   top.center_x = top.dim_x / 2;
@@ -1094,6 +1129,232 @@ std::string to_string(const Draw& draw) {
   return to_string(s);
 }
 
+// The characters drawing the |options| style.
+Style MakeStyle(const OptionSet& options) {
+  const std::string& style_option = options.Get("style");
+  const bool transform_math_letters =
+      options.GetBool("transform_math_letters");
+  Style style;
+  if (style_option == "ASCII") {
+    style.divide = L'-';
+    style.multiply = L'.';
+    style.greater_or_equal = L">=";
+    style.lime = L"->";
+    style.lower_or_equal = L"<=";
+    style.left_parenthesis_0 = L'(';
+    style.left_parenthesis_1 = L'/';
+    style.left_parenthesis_2 = L'|';
+    style.left_parenthesis_3 = L'\\';
+    style.right_parenthesis_0 = L')';
+    style.right_parenthesis_1 = L'\\';
+    style.right_parenthesis_2 = L'|';
+    style.right_parenthesis_3 = L'/';
+
+    style.sqrt_0 = L'\\';
+    style.sqrt_1 = L'/';
+    style.sqrt_2 = L'_';
+
+    style.summation_top = L'=';
+    style.summation_bottom = L'=';
+    style.summation_diagonal_top = L'\\';
+    style.summation_diagonal_bottom = L'/';
+
+    style.mult_top = L'_';
+    style.mult_bottom = L'|';
+    style.mult_intersection = L'_';
+
+    style.integral_top = {L' ', L'.', L'-'};
+    style.integral_middle = {L' ', L'|', L' '};
+    style.integral_bottom = {L'-', L'\'', L' '};
+    style.integral_min_height = 3;
+  } else {
+    style.divide = L'─';
+    // style.multiply = L'×';
+    style.multiply = L'⋅';
+    style.greater_or_equal = L"≥";
+    style.lime = L"⟶";
+    style.lower_or_equal = L"≤";
+
+    style.left_parenthesis_0 = L'(';
+    style.left_parenthesis_1 = L'⎛';
+    style.left_parenthesis_2 = L'⎜';
+    style.left_parenthesis_3 = L'⎝';
+    style.right_parenthesis_0 = L')';
+    style.right_parenthesis_1 = L'⎞';
+    style.right_parenthesis_2 = L'⎟';
+    style.right_parenthesis_3 = L'⎠';
+
+    style.sqrt_0 = L'╲';
+    style.sqrt_1 = L'╱';
+    style.sqrt_2 = L'_';
+
+    style.summation_top = L'_';
+    style.summation_bottom = L'‾';
+    style.summation_diagonal_top = L'╲';
+    style.summation_diagonal_bottom = L'╱';
+
+    style.mult_top = L'━';
+    style.mult_bottom = L'┃';
+    style.mult_intersection = L'┳';
+
+    style.integral_top = {L'⌠'};
+    style.integral_middle = {L'⎮'};
+    style.integral_bottom = {L'⌡'};
+    style.integral_min_height = 2;
+  }
+
+  if (style_option == "Latex") {
+    if (transform_math_letters) {
+      style.variable_transform = {
+          // Greek alphabet
+          {L"...", L"\\ldots"},
+          {L"Alpha", L"\\Alpha"},
+          {L"alpha", L"\\alpha"},
+          {L"Digamma", L"\\Digamma"},
+          {L"digamma", L"\\digamma"},
+          {L"Kappa", L"\\Kappa"},
+          {L"kappa", L"\\kappa"},
+          {L"Omicron", L"\\Omicron"},
+          {L"omicron", L"\\omicron"},
+          {L"Upsilon", L"\\Upsilon"},
+          {L"upsilon", L"\\upsilon"},
+          {L"Beta", L"\\Beta"},
+          {L"beta", L"\\beta"},
+          {L"Zeta", L"\\Zeta"},
+          {L"zeta", L"\\zeta"},
+          {L"Lambda", L"\\Lambda"},
+          {L"lambda", L"\\lambda"},
+          {L"Pi", L"\\Pi"},
+          {L"pi", L"\\pi"},
+          {L"Phi", L"\\Phi"},
+          {L"phi", L"\\phi"},
+          {L"Gamma", L"\\Gamma"},
+          {L"gamma", L"\\gamma"},
+          {L"Eta", L"\\Eta"},
+          {L"eta", L"\\eta"},
+          {L"Mu", L"\\Mu"},
+          {L"mu", L"\\mu"},
+          {L"Rho", L"\\Rho"},
+          {L"rho", L"\\rho"},
+          {L"Chi", L"\\Chi"},
+          {L"chi", L"\\chi"},
+          {L"Delta", L"\\Delta"},
+          {L"delta", L"\\delta"},
+          {L"Theta", L"\\Theta"},
+          {L"theta", L"\\theta"},
+          {L"Nu", L"\\Nu"},
+          {L"nu", L"\\nu"},
+          {L"Sigma", L"\\Sigma"},
+          {L"sigma", L"\\sigma"},
+          {L"Psi", L"\\Psi"},
+          {L"psi", L"\\psi"},
+          {L"Epsilon", L"\\Epsilon"},
+          {L"epsilon", L"\\epsilon"},
+          {L"Iota", L"\\Iota"},
+          {L"iota", L"\\iota"},
+          {L"Xi", L"\\Xi"},
+          {L"xi", L"\\xi"},
+          {L"Tau", L"\\Tau"},
+          {L"tau", L"\\tau"},
+          {L"Omega", L"\\Omega"},
+          {L"omega", L"\\omega"},
+
+          // Symbols
+          {L"infty", L"\\infty"},
+          {L"infinity", L"\\infty"},
+      };
+    }
+
+    style.variable_transform[L"..."] = L"\\ldots";
+  } else if (transform_math_letters) {
+    style.variable_transform = {
+        // Greek alphabet
+        {L"Alpha", L"Α"},
+        {L"alpha", L"α"},
+        {L"Digamma", L"Ϝ"},
+        {L"digamma", L"ϝ"},
+        {L"Kappa", L"Κ"},
+        {L"kappa", L"ϰ"},
+        {L"Omicron", L"Ο"},
+        {L"omicron", L"ο"},
+        {L"Upsilon", L"Υ"},
+        {L"upsilon", L"υ"},
+        {L"Beta", L"Β"},
+        {L"beta", L"β"},
+        {L"Zeta", L"Ζ"},
+        {L"zeta", L"ζ"},
+        {L"Lambda", L"Λ"},
+        {L"lambda", L"λ"},
+        {L"Pi", L"Π"},
+        {L"pi", L"π"},
+        {L"Phi", L"ϕ"},
+        {L"phi", L"φ"},
+        {L"Gamma", L"Γ"},
+        {L"gamma", L"γ"},
+        {L"Eta", L"Η"},
+        {L"eta", L"η"},
+        {L"Mu", L"Μ"},
+        {L"mu", L"μ"},
+        {L"Rho", L"ρ"},
+        {L"rho", L"ϱ"},
+        {L"Chi", L"Χ"},
+        {L"chi", L"χ"},
+        {L"Delta", L"Δ"},
+        {L"delta", L"δ"},
+        {L"Theta", L"θ"},
+        {L"theta", L"ϑ"},
+        {L"Nu", L"Ν"},
+        {L"nu", L"ν"},
+        {L"Sigma", L"σ"},
+        {L"sigma", L"ς"},
+        {L"Psi", L"Ψ"},
+        {L"psi", L"ψ"},
+        {L"Epsilon", L"ϵ"},
+        {L"epsilon", L"ε"},
+        {L"Iota", L"Ι"},
+        {L"iota", L"ι"},
+        {L"Xi", L"Ξ"},
+        {L"xi", L"ξ"},
+        {L"Tau", L"Τ"},
+        {L"tau", L"τ"},
+        {L"Omega", L"Ω"},
+        {L"omega", L"ω"},
+
+        // Symbols
+        {L"infty", L"∞"},
+        {L"infinity", L"∞"},
+    };
+  }
+
+  return style;
+}
+
+// The parse tree of an input, drawn in each style. The ANTLR objects own the
+// tree, so they are kept alive with it.
+class MathLayout : public TranslationLayout {
+ public:
+  void Rasterize(const OptionSet& options, Sink* sink) const override {
+    if (!content)
+      return;
+
+    Style style = MakeStyle(options);
+    if (options.Get("style") == "Latex") {
+      sink->Write(to_string(ParseLatex(content, &style)));
+      sink->Write("\n");
+      return;
+    }
+    sink->Write(to_string(Parse(content, &style)));
+  }
+
+  std::unique_ptr<antlr4::ANTLRInputStream> input_stream;
+  std::unique_ptr<MathLexer> lexer;
+  std::unique_ptr<antlr4::CommonTokenStream> tokens;
+  AntlrErrorListener error_listener;
+  std::unique_ptr<MathParser> parser;
+  // nullptr when the input couldn't be parsed.
+  MathParser::MultilineEquationContext* content = nullptr;
+};
+
 class Math : public Translator {
  public:
   ~Math() override = default;
@@ -1102,7 +1363,7 @@ class Math : public Translator {
   const char* Identifier() final { return "Math"; }
   const char* Description() final { return "Math description"; }
 
-  std::vector<Translator::OptionDescription> Options() final {
+  std::vector<Translator::OptionDescription> Options() const final {
     return {
         {
             "style",
@@ -1114,6 +1375,7 @@ class Math : public Translator {
             "Unicode",
             "Use the full unicode charset or only ASCII. Or even latex.",
             Widget::Combobox,
+            /*style=*/true,
         },
         {
             "transform_math_letters",
@@ -1124,6 +1386,7 @@ class Math : public Translator {
             "true",
             "Transform letter name into their unicode glyph. alpha -> α.",
             Widget::Checkbox,
+            /*style=*/true,
         },
     };
   }
@@ -1216,229 +1479,45 @@ class Math : public Translator {
   }
 
   std::string Translate(const std::string& input,
-                        const std::string& options_string) final {
-    auto options = SerializeOption(options_string);
-    Style style;
-    if (options["style"] == "ASCII") {
-      style.divide = L'-';
-      style.multiply = L'.';
-      style.greater_or_equal = L">=";
-      style.lime = L"->";
-      style.lower_or_equal = L"<=";
-      style.left_parenthesis_0 = L'(';
-      style.left_parenthesis_1 = L'/';
-      style.left_parenthesis_2 = L'|';
-      style.left_parenthesis_3 = L'\\';
-      style.right_parenthesis_0 = L')';
-      style.right_parenthesis_1 = L'\\';
-      style.right_parenthesis_2 = L'|';
-      style.right_parenthesis_3 = L'/';
-
-      style.sqrt_0 = L'\\';
-      style.sqrt_1 = L'/';
-      style.sqrt_2 = L'_';
-
-      style.summation_top = L'=';
-      style.summation_bottom = L'=';
-      style.summation_diagonal_top = L'\\';
-      style.summation_diagonal_bottom = L'/';
-
-      style.mult_top = L'_';
-      style.mult_bottom = L'|';
-      style.mult_intersection = L'_';
-
-      style.integral_top = {L' ', L'.', L'-'};
-      style.integral_middle = {L' ', L'|', L' '};
-      style.integral_bottom = {L'-', L'\'', L' '};
-      style.integral_min_height = 3;
-    } else {
-      style.divide = L'─';
-      // style.multiply = L'×';
-      style.multiply = L'⋅';
-      style.greater_or_equal = L"≥";
-      style.lime = L"⟶";
-      style.lower_or_equal = L"≤";
-
-      style.left_parenthesis_0 = L'(';
-      style.left_parenthesis_1 = L'⎛';
-      style.left_parenthesis_2 = L'⎜';
-      style.left_parenthesis_3 = L'⎝';
-      style.right_parenthesis_0 = L')';
-      style.right_parenthesis_1 = L'⎞';
-      style.right_parenthesis_2 = L'⎟';
-      style.right_parenthesis_3 = L'⎠';
-
-      style.sqrt_0 = L'╲';
-      style.sqrt_1 = L'╱';
-      style.sqrt_2 = L'_';
-
-      style.summation_top = L'_';
-      style.summation_bottom = L'‾';
-      style.summation_diagonal_top = L'╲';
-      style.summation_diagonal_bottom = L'╱';
-
-      style.mult_top = L'━';
-      style.mult_bottom = L'┃';
-      style.mult_intersection = L'┳';
-
-      style.integral_top = {L'⌠'};
-      style.integral_middle = {L'⎮'};
-      style.integral_bottom = {L'⌡'};
-      style.integral_min_height = 2;
-    }
-
-    if (options["style"] == "Latex") {
-      if (options["transform_math_letters"] != "false") {
-        style.variable_transform = {
-            // Greek alphabet
-            {L"...", L"\\ldots"},
-            {L"Alpha", L"\\Alpha"},
-            {L"alpha", L"\\alpha"},
-            {L"Digamma", L"\\Digamma"},
-            {L"digamma", L"\\digamma"},
-            {L"Kappa", L"\\Kappa"},
-            {L"kappa", L"\\kappa"},
-            {L"Omicron", L"\\Omicron"},
-            {L"omicron", L"\\omicron"},
-            {L"Upsilon", L"\\Upsilon"},
-            {L"upsilon", L"\\upsilon"},
-            {L"Beta", L"\\Beta"},
-            {L"beta", L"\\beta"},
-            {L"Zeta", L"\\Zeta"},
-            {L"zeta", L"\\zeta"},
-            {L"Lambda", L"\\Lambda"},
-            {L"lambda", L"\\lambda"},
-            {L"Pi", L"\\Pi"},
-            {L"pi", L"\\pi"},
-            {L"Phi", L"\\Phi"},
-            {L"phi", L"\\phi"},
-            {L"Gamma", L"\\Gamma"},
-            {L"gamma", L"\\gamma"},
-            {L"Eta", L"\\Eta"},
-            {L"eta", L"\\eta"},
-            {L"Mu", L"\\Mu"},
-            {L"mu", L"\\mu"},
-            {L"Rho", L"\\Rho"},
-            {L"rho", L"\\rho"},
-            {L"Chi", L"\\Chi"},
-            {L"chi", L"\\chi"},
-            {L"Delta", L"\\Delta"},
-            {L"delta", L"\\delta"},
-            {L"Theta", L"\\Theta"},
-            {L"theta", L"\\theta"},
-            {L"Nu", L"\\Nu"},
-            {L"nu", L"\\nu"},
-            {L"Sigma", L"\\Sigma"},
-            {L"sigma", L"\\sigma"},
-            {L"Psi", L"\\Psi"},
-            {L"psi", L"\\psi"},
-            {L"Epsilon", L"\\Epsilon"},
-            {L"epsilon", L"\\epsilon"},
-            {L"Iota", L"\\Iota"},
-            {L"iota", L"\\iota"},
-            {L"Xi", L"\\Xi"},
-            {L"xi", L"\\xi"},
-            {L"Tau", L"\\Tau"},
-            {L"tau", L"\\tau"},
-            {L"Omega", L"\\Omega"},
-            {L"omega", L"\\omega"},
-
-            // Symbols
-            {L"infty", L"\\infty"},
-            {L"infinity", L"\\infty"},
-        };
-      }
-
-      style.variable_transform[L"..."] = L"\\ldots";
-    } else if (options["transform_math_letters"] != "false") {
-      style.variable_transform = {
-          // Greek alphabet
-          {L"Alpha", L"Α"},
-          {L"alpha", L"α"},
-          {L"Digamma", L"Ϝ"},
-          {L"digamma", L"ϝ"},
-          {L"Kappa", L"Κ"},
-          {L"kappa", L"ϰ"},
-          {L"Omicron", L"Ο"},
-          {L"omicron", L"ο"},
-          {L"Upsilon", L"Υ"},
-          {L"upsilon", L"υ"},
-          {L"Beta", L"Β"},
-          {L"beta", L"β"},
-          {L"Zeta", L"Ζ"},
-          {L"zeta", L"ζ"},
-          {L"Lambda", L"Λ"},
-          {L"lambda", L"λ"},
-          {L"Pi", L"Π"},
-          {L"pi", L"π"},
-          {L"Phi", L"ϕ"},
-          {L"phi", L"φ"},
-          {L"Gamma", L"Γ"},
-          {L"gamma", L"γ"},
-          {L"Eta", L"Η"},
-          {L"eta", L"η"},
-          {L"Mu", L"Μ"},
-          {L"mu", L"μ"},
-          {L"Rho", L"ρ"},
-          {L"rho", L"ϱ"},
-          {L"Chi", L"Χ"},
-          {L"chi", L"χ"},
-          {L"Delta", L"Δ"},
-          {L"delta", L"δ"},
-          {L"Theta", L"θ"},
-          {L"theta", L"ϑ"},
-          {L"Nu", L"Ν"},
-          {L"nu", L"ν"},
-          {L"Sigma", L"σ"},
-          {L"sigma", L"ς"},
-          {L"Psi", L"Ψ"},
-          {L"psi", L"ψ"},
-          {L"Epsilon", L"ϵ"},
-          {L"epsilon", L"ε"},
-          {L"Iota", L"Ι"},
-          {L"iota", L"ι"},
-          {L"Xi", L"Ξ"},
-          {L"xi", L"ξ"},
-          {L"Tau", L"Τ"},
-          {L"tau", L"τ"},
-          {L"Omega", L"Ω"},
-          {L"omega", L"ω"},
+                        const OptionSet& options) const final {
+    std::string output;
+    auto layout = ComputeLayout(input, options);
+    layout->Rasterize(options, StringSink(&output).get());
+    return output;
+  }
 
-          // Symbols
-          {L"infty", L"∞"},
-          {L"infinity", L"∞"},
-      };
-    }
+  std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const final {
+    auto layout = std::make_unique<MathLayout>();
 
-    antlr4::ANTLRInputStream input_stream(input);
+    // Lexers and parsers share caches. See |AntlrMutex|.
+    std::lock_guard<std::mutex> lock(AntlrMutex());
+    layout->input_stream = std::make_unique<antlr4::ANTLRInputStream>(input);
 
     // Lexer.
-    MathLexer lexer(&input_stream);
-    antlr4::CommonTokenStream tokens(&lexer);
-    tokens.fill();
+    layout->lexer = std::make_unique<MathLexer>(layout->input_stream.get());
+    layout->tokens =
+        std::make_unique<antlr4::CommonTokenStream>(layout->lexer.get());
+    layout->tokens->fill();
 
     // Parser.
-    AntlrErrorListener error_listener;
-    MathParser parser(&tokens);
-    parser.addErrorListener(&error_listener);
+    layout->parser = std::make_unique<MathParser>(layout->tokens.get());
+    layout->parser->addErrorListener(&layout->error_listener);
 
-    MathParser::MultilineEquationContext* content = nullptr;
     try {
-      content = parser.multilineEquation();
+      layout->content = layout->parser->multilineEquation();
     } catch (...) {
-      return "";
+      layout->content = nullptr;
     }
-
-    if (options["style"] == "Latex")
-      return to_string(ParseLatex(content, &style)) + '\n';
-
-    // Print th
-    return to_string(Parse(content, &style));
+    return layout;
   }
 
   std::string Highlight(const std::string& input) final {
     std::stringstream out;
 
+    // Lexers and parsers share caches. See |AntlrMutex|.
+    std::lock_guard<std::mutex> lock(AntlrMutex());
     antlr4::ANTLRInputStream input_stream(input);
 
     // Lexer.
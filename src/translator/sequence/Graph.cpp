@@ -4,9 +4,10 @@
 
 #include "translator/sequence/Graph.hpp"
 #include <algorithm>
-#include <iostream>
 #include <map>
 #include <vector>
+#include "translator/Budget.h"
+#include "translator/Diagnostics.h"
 
 namespace graph {
 
@@ -37,6 +38,7 @@ std::vector<Node> FindTopologicalOrder(const Graph& graph) {
   bool work_to_do = true;
   int iteration = 0;
   while (work_to_do) {
+    BudgetStep(graph.size());
     work_to_do = false;
     for (const auto& edge : graph) {
       if (weight[edge.to] <= weight[edge.from]) {
@@ -47,7 +49,7 @@ std::vector<Node> FindTopologicalOrder(const Graph& graph) {
 
     iteration++;
     if (iteration >= 1000) {
-      std::cout << "There are cycles" << std::endl;
+      ReportDiagnostic({"sequence-cycle", 0, 0, "There are cycles"});
       break;
     }
   }
@@ -4,13 +4,23 @@
 
 #include "translator/sequence/Sequence.hpp"
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <memory_resource>
 #include <queue>
 #include <set>
 #include <sstream>
 #include <string>
 #include <vector>
+#include "screen/InternedRows.h"
+#include "screen/Scene.h"
 #include "screen/Screen.h"
+#include "screen/Sink.h"
+#include "translator/Arena.h"
+#include "translator/Budget.h"
+#include "translator/Diagnostics.h"
 #include "translator/antlr_error_listener.h"
 #include "translator/sequence/Graph.hpp"
 
@@ -29,44 +39,158 @@ void SplitString(std::wstring input,
   out->push_back(input.substr(start));
 }
 
+// The drawing of a sequence diagram.
+class SequenceLayout : public TranslationLayout {
+ public:
+  void Rasterize(const OptionSet& options, Sink* sink) const override {
+    Screen screen = scene.Rasterize();
+    if (options.GetBool("ascii_only"))
+      screen.ASCIIfy(0);
+
+    // The lifelines repeat the same rows, encoded once.
+    InternedRows(screen).Write(sink);
+  }
+
+  Scene scene;
+};
+
 }  // namespace
 
-void Actor::Draw(Screen& screen, int height) {
-  screen.DrawBoxedText(left, 0, name);
-  screen.DrawVerticalLine(3, height - 4, center);
-  screen.DrawBoxedText(left, height - 3, name);
-  screen.DrawPixel(center, 2, L'┬');
-  screen.DrawPixel(center, height - 3, L'┴');
+// Keeps the commands of every line, and parses again only the lines damaged by
+// an edit. The layout depends on every message, so it is computed again from
+// the commands.
+class SequenceSession : public TranslationSession {
+ public:
+  SequenceSession(std::string input, const OptionSet& options)
+      : TranslationSession(std::move(input)), options_(options) {
+    lines_ = Split(0, input_.size());
+  }
+
+  void RenderTo(Sink* sink) override {
+    if (!layout_) {
+      diagnostics_.clear();
+      ScopedDiagnostics scoped_diagnostics(&diagnostics_);
+      layout_ = ComputeLayout();
+    }
+    for (const Diagnostic& diagnostic : diagnostics_)
+      ReportDiagnostic(diagnostic);
+    layout_->Rasterize(options_, sink);
+  }
+
+ private:
+  void OnEdit(size_t offset, size_t removed, size_t inserted) override {
+    // The lines containing both ends of the replaced bytes.
+    size_t first = 0;
+    size_t first_start = 0;
+    while (first_start + lines_[first].size < offset)
+      first_start += lines_[first++].size + 1;
+
+    size_t last = first;
+    size_t last_start = first_start;
+    while (last_start + lines_[last].size < offset + removed)
+      last_start += lines_[last++].size + 1;
+
+    size_t end = last_start + lines_[last].size + inserted - removed;
+    std::vector<SequenceLine> lines = Split(first_start, end);
+    lines_.erase(lines_.begin() + first, lines_.begin() + last + 1);
+    lines_.insert(lines_.begin() + first,
+                  std::make_move_iterator(lines.begin()),
+                  std::make_move_iterator(lines.end()));
+    layout_.reset();
+  }
+
+  // The unparsed lines of |input_| from |begin| to |end|.
+  std::vector<SequenceLine> Split(size_t begin, size_t end) const {
+    std::vector<SequenceLine> lines;
+    while (true) {
+      size_t line_end = input_.find('\n', begin);
+      if (line_end == std::string::npos || line_end > end)
+        line_end = end;
+      lines.emplace_back();
+      lines.back().size = line_end - begin;
+      if (line_end == end)
+        return lines;
+      begin = line_end + 1;
+    }
+  }
+
+  std::unique_ptr<TranslationLayout> ComputeLayout() {
+    Sequence sequence;
+
+    // Block comments can span several lines. Parse the input as a whole.
+    if (input_.find("/*") != std::string::npos)
+      return sequence.Process(input_, options_);
+
+    bool ok = true;
+    size_t start = 0;
+    for (size_t i = 0; i < lines_.size(); ++i) {
+      SequenceLine& line = lines_[i];
+      if (!line.parsed) {
+        std::string text = input_.substr(start, line.size);
+        // "\r\n" ends a line.
+        if (i + 1 != lines_.size() && !text.empty() && text.back() == '\r')
+          text.pop_back();
+        Sequence::ParseLine(text, &line);
+      }
+      ok &= line.ok;
+      start += line.size + 1;
+    }
+
+    // An invalid line invalidates the whole input.
+    if (ok) {
+      for (size_t i = 0; i < lines_.size(); ++i)
+        sequence.AddLine(lines_[i], i + 1);
+    }
+    return sequence.ProcessRepresentation(options_);
+  }
+
+  OptionSet options_;
+  std::vector<SequenceLine> lines_;
+  std::unique_ptr<TranslationLayout> layout_;
+  // Found while computing |layout_|, and reported on every render.
+  std::vector<Diagnostic> diagnostics_;
+};
+
+void Actor::Draw(Scene& scene, int height) {
+  scene.DrawBoxedText(left, 0, name);
+  scene.DrawVerticalLine(3, height - 4, center);
+  scene.DrawBoxedText(left, height - 3, name);
+  scene.DrawPixel(center, 2, L'┬');
+  scene.DrawPixel(center, height - 3, L'┴');
 }
 
-void Message::Draw(Screen& screen) {
+void Message::Draw(Scene& scene) {
+  const Scene::Stroke stroke =
+      dashed ? Scene::Stroke::Dashed : Scene::Stroke::Solid;
   if (line_top == line_bottom) {
-    screen.DrawHorizontalLine(line_left, line_right, line_top, dashed ? L'-' : L'─');
+    scene.DrawPolyline({{line_left, line_top}, {line_right, line_top}}, stroke);
   } else if (direction == Direction::Right) {
-    screen.DrawHorizontalLine(line_left, line_left + offset, line_top, dashed ? L'-' : L'─');
-    screen.DrawVerticalLine(line_top, line_bottom, line_left + offset, dashed ? L'|' : L'│');
-    screen.DrawHorizontalLine(line_left + offset, line_right, line_bottom, dashed ? L'-' : L'─');
-    screen.DrawPixel(line_left + offset, line_top, dashed ? L'.' : L'┐');
-    screen.DrawPixel(line_left + offset, line_bottom, dashed ? L'`' : L'└');
+    scene.DrawPolyline({{line_left, line_top},
+                        {line_left + offset, line_top},
+                        {line_left + offset, line_bottom},
+                        {line_right, line_bottom}},
+                       stroke);
   } else {
-    screen.DrawHorizontalLine(line_right - offset, line_right, line_top, dashed ? L'-' : L'─');
-    screen.DrawVerticalLine(line_top, line_bottom, line_right - offset, dashed ? L'|' : L'│');
-    screen.DrawHorizontalLine(line_left, line_right - offset, line_bottom, dashed ? L'-' : L'─');
-    screen.DrawPixel(line_right - offset, line_top, L'.');
-    screen.DrawPixel(line_right - offset, line_bottom, L'`');
+    scene.DrawPolyline({{line_right, line_top},
+                        {line_right - offset, line_top},
+                        {line_right - offset, line_bottom},
+                        {line_left, line_bottom}},
+                       stroke);
+    scene.DrawPixel(line_right - offset, line_top, L'.');
+    scene.DrawPixel(line_right - offset, line_bottom, L'`');
   }
 
   // Tip of the arrow.
   if (direction == Direction::Right) {
-    screen.DrawPixel(line_right, line_bottom, L'>');
+    scene.DrawPixel(line_right, line_bottom, L'>');
   } else {
-    screen.DrawPixel(line_left, line_bottom, L'<');
+    scene.DrawPixel(line_left, line_bottom, L'<');
   }
 
   // The message
   int y = top;
   for (auto& line : messages) {
-    screen.DrawText(left, y, line);
+    scene.DrawText(left, y, line);
     ++y;
   }
 }
@@ -83,15 +207,19 @@ std::vector<std::set<int>> Cut(const MessageDependencies& message_dependencies,
                                std::function<bool(int, int)> preference) {
   std::vector<std::set<int>> output;
 
+  // The temporary containers below are allocated from the translation arena,
+  // when there is one.
+  std::pmr::memory_resource* memory = TranslationMemory();
+
   // Groups the nodes that independants on each other.
   std::vector<MessageDependencies> independants;
   {
-    std::map<int, std::set<int>> neighbours;
+    std::pmr::map<int, std::pmr::set<int>> neighbours(memory);
     for (const Dependency& dependency : message_dependencies.dependencies) {
       neighbours[dependency.from].insert(dependency.to);
       neighbours[dependency.to].insert(dependency.from);
     }
-    std::set<int> non_used;
+    std::pmr::set<int> non_used(memory);
     for (int message : message_dependencies.messages) {
       non_used.insert(message);
     }
@@ -121,7 +249,7 @@ std::vector<std::set<int>> Cut(const MessageDependencies& message_dependencies,
     }
 
     // Split the dependencies between each independant groups.
-    std::map<int, int> index;
+    std::pmr::map<int, int> index(memory);
     for (int i = 0; i < independants.size(); ++i) {
       for (int j : independants[i].messages)
         index[j] = i;
@@ -144,11 +272,12 @@ std::vector<std::set<int>> Cut(const MessageDependencies& message_dependencies,
     std::vector<MessageSetWithWeight> cycles;
     {
       // Compute initial state.
-      std::map<int, std::set<int>> reachable_from;
+      std::pmr::map<int, std::pmr::set<int>> reachable_from(memory);
       for (int message : dependant.messages) {
         reachable_from[message].insert(message);
       }
-      std::map<int, std::set<int>> new_reachable_from(reachable_from);
+      std::pmr::map<int, std::pmr::set<int>> new_reachable_from(reachable_from,
+                                                                memory);
 
       // Find the closure.
       while (true) {
@@ -164,7 +293,7 @@ std::vector<std::set<int>> Cut(const MessageDependencies& message_dependencies,
       }
 
       // Group elements that can reach the same set of elements.
-      std::map<std::set<int>, std::set<int>> groups;
+      std::pmr::map<std::pmr::set<int>, std::set<int>> groups(memory);
       for (const auto& it : reachable_from) {
         groups[it.second].insert(it.first);
       }
@@ -214,7 +343,7 @@ const char* Sequence::Description() {
   return "Draw sequence diagram";
 }
 
-std::vector<Translator::OptionDescription> Sequence::Options() {
+std::vector<Translator::OptionDescription> Sequence::Options() const {
   return {
       {
           "ascii_only",
@@ -225,6 +354,7 @@ std::vector<Translator::OptionDescription> Sequence::Options() {
           "false",
           "Use the full unicode charset or only ASCII.",
           Widget::Checkbox,
+          /*style=*/true,
       },
       {
           "interpret_backslash_n",
@@ -275,21 +405,53 @@ std::vector<Translator::Example> Sequence::Examples() {
 }
 
 std::string Sequence::Translate(const std::string& input,
-                                const std::string& options_string) {
-  *this = Sequence();
+                                const OptionSet& options) const {
+  std::string output;
+  TranslateTo(input, options, StringSink(&output).get());
+  return output;
+}
 
-  auto options = SerializeOption(options_string);
-  ascii_only_ = (options["ascii_only"] == "true");
-  interpret_backslash_n_ = (options["interpret_backslash_n"] != "false");
+void Sequence::TranslateTo(const std::string& input,
+                           const OptionSet& options,
+                           Sink* sink) const {
+  ComputeLayout(input, options)->Rasterize(options, sink);
+}
+
+std::unique_ptr<TranslationLayout> Sequence::ComputeLayout(
+    const std::string& input,
+    const OptionSet& options) const {
+  // The translation state lives in a fresh Sequence, so that this one stays
+  // untouched and can be shared between threads.
+  Sequence sequence;
+  return sequence.Process(input, options);
+}
 
+std::unique_ptr<TranslationSession> Sequence::OpenSession(
+    const std::string& input,
+    const OptionSet& options) const {
+  return std::make_unique<SequenceSession>(input, options);
+}
+
+std::unique_ptr<TranslationLayout> Sequence::Process(
+    const std::string& input,
+    const OptionSet& options) {
   ComputeInternalRepresentation(input);
+  return ProcessRepresentation(options);
+}
+
+std::unique_ptr<TranslationLayout> Sequence::ProcessRepresentation(
+    const OptionSet& options) {
+  interpret_backslash_n_ = options.GetBool("interpret_backslash_n");
+
+  auto layout = std::make_unique<SequenceLayout>();
   UniformizeInternalRepresentation();
   if (actors.size() == 0)
-    return "";
+    return layout;
 
   SplitByBackslashN();
   Layout();
-  return Draw();
+  Draw(&layout->scene);
+  return layout;
 }
 
 void Sequence::SplitByBackslashN() {
@@ -304,7 +466,9 @@ void Sequence::SplitByBackslashN() {
   }
 }
 
-void Sequence::ComputeInternalRepresentation(const std::string& input) {
+bool Sequence::ComputeInternalRepresentation(const std::string& input) {
+  // Lexers and parsers share caches. See |AntlrMutex|.
+  std::unique_lock<std::mutex> lock(AntlrMutex());
   antlr4::ANTLRInputStream input_stream(input);
 
   // Lexer.
@@ -321,15 +485,36 @@ void Sequence::ComputeInternalRepresentation(const std::string& input) {
   try {
     program = parser.program();
   } catch (...) {
-    return;
+    return false;
   }
+  lock.unlock();
 
   for (SequenceParser::CommandContext* command : program->command()) {
     AddCommand(command);
   }
+  return true;
+}
+
+void Sequence::RemoveSelfMessages() {
+  auto is_self_message = [](const Message& message) {
+    if (message.from != message.to)
+      return false;
+    ReportDiagnostic({
+        "sequence-self-message",
+        message.line,
+        message.column,
+        "Self messages are not supported yet. It has been ignored. See "
+        "https://github.com/ArthurSonzogni/Diagon/issues/63",
+    });
+    return true;
+  };
+  messages.erase(
+      std::remove_if(messages.begin(), messages.end(), is_self_message),
+      messages.end());
 }
 
 void Sequence::UniformizeInternalRepresentation() {
+  RemoveSelfMessages();
   UniformizeActors();
   UniformizeMessageID();
 }
@@ -360,8 +545,13 @@ void Sequence::UniformizeMessageID() {
     for (auto& message : messages) {
       if (message.id != -1) {
         if (used.count(message.id)) {
-          std::cerr << "Found two messages with the same id: " << message.id
-                    << std::endl;
+          ReportDiagnostic({
+              "sequence-duplicate-message-id",
+              message.line,
+              message.column,
+              "Found two messages with the same id: " +
+                  std::to_string(message.id),
+          });
           message.id = -1;
         } else {
           used.insert(message.id);
@@ -379,30 +569,39 @@ void Sequence::UniformizeMessageID() {
       }
     }
     for (Actor& actor : actors) {
+      const auto ignore = [&actor](const Dependency& dependency,
+                                   const std::string& reason) {
+        if (!DiagnosticsEnabled())
+          return;
+        ReportDiagnostic({
+            "sequence-ignored-dependency",
+            actor.line,
+            actor.column,
+            "Ignored dependency: \"" + to_string(actor.name) + ": " +
+                std::to_string(dependency.from) + " < " +
+                std::to_string(dependency.to) +
+                "\". It cannot be used because " + reason,
+        });
+      };
       const auto is_dependency_invalid =
-          [&message_index, this, &actor](const Dependency& dependency) -> bool {
+          [&message_index, this, &actor,
+           &ignore](const Dependency& dependency) -> bool {
         for (int id : {dependency.from, dependency.to}) {
           auto it = message_index.find(id);
           if (it == message_index.end()) {
-            std::wcerr << "* Ignored dependency: \"" << actor.name << ": "
-                       << dependency.from << " < " << dependency.to << "\"."
-                       << std::endl;
-            std::wcerr << "  It cannot be used because the message ID \"" << id
-                       << "\" doesn't exist" << std::endl;
+            ignore(dependency, "the message ID \"" + std::to_string(id) +
+                                   "\" doesn't exist");
             return true;
           }
 
           const Message& message = messages[it->second];
           if (actor.name != message.from &&  //
               actor.name != message.to) {
-            std::wcerr << "* Ignored dependency: \"" << actor.name << ": "
-                       << dependency.from << " < " << dependency.to << "\"."
-                       << std::endl;
-            std::wcerr << "  It cannot be used because the message \""
-                       << message.from << " -> " << message.to << ": "
-                       << message.messages[0]
-                       << "\" has nothing to do with actor " << actor.name
-                       << std::endl;
+            ignore(dependency, "the message \"" + to_string(message.from) +
+                                   " -> " + to_string(message.to) + ": " +
+                                   to_string(message.messages[0]) +
+                                   "\" has nothing to do with actor " +
+                                   to_string(actor.name));
             return true;
           }
         }
@@ -455,6 +654,8 @@ void Sequence::AddCommand(SequenceParser::CommandContext* command) {
 void Sequence::AddMessageCommand(
     SequenceParser::MessageCommandContext* message_command) {
   Message message;
+  message.line = message_command->getStart()->getLine();
+  message.column = message_command->getStart()->getCharPositionInLine() + 1;
   if (auto dependency_id = message_command->dependencyID()) {
     message.id =
         std::stoi(dependency_id->number()->NUMBER()->getSymbol()->getText());
@@ -465,14 +666,6 @@ void Sequence::AddMessageCommand(
   message.dashed = message_command->arrow()->ARROW_LEFT_DASHED() != nullptr ||
                    message_command->arrow()->ARROW_RIGHT_DASHED() != nullptr;
 
-  if (message.from == message.to) {
-    std::cerr << "Self messages are not supported yet. It has been ignored."
-              << std::endl;
-    std::cerr << "See https://github.com/ArthurSonzogni/Diagon/issues/63"
-              << std::endl;
-    return;
-  }
-
   if (message_command->arrow()->ARROW_LEFT() ||
       message_command->arrow()->ARROW_LEFT_DASHED()) {
     std::swap(message.from, message.to);
@@ -484,14 +677,10 @@ void Sequence::AddMessageCommand(
 
 void Sequence::AddDependencyCommand(
     SequenceParser::DependencyCommandContext* dependency_command) {
-  std::wstring name = GetText(dependency_command->text());
-  if (!actor_index.count(name)) {
-    actor_index[name] = actors.size();
-    actors.emplace_back();
-  }
-  Actor& actor = actors[actor_index[name]];
-  actor.name = name;
-
+  Actor actor;
+  actor.name = GetText(dependency_command->text());
+  actor.line = dependency_command->getStart()->getLine();
+  actor.column = dependency_command->getStart()->getCharPositionInLine() + 1;
   for (auto dependency : dependency_command->dependencies()->dependency()) {
     auto numbers = dependency->number();
     auto comparison = dependency->comparison();
@@ -504,6 +693,39 @@ void Sequence::AddDependencyCommand(
       actor.dependencies.insert(Dependency{left, right});
     }
   }
+  AddActor(actor);
+}
+
+void Sequence::AddActor(const Actor& actor) {
+  if (!actor_index.count(actor.name)) {
+    actor_index[actor.name] = actors.size();
+    actors.emplace_back();
+    actors.back().line = actor.line;
+    actors.back().column = actor.column;
+  }
+  Actor& it = actors[actor_index[actor.name]];
+  it.name = actor.name;
+  it.dependencies.insert(actor.dependencies.begin(), actor.dependencies.end());
+}
+
+void Sequence::ParseLine(const std::string& text, SequenceLine* line) {
+  Sequence sequence;
+  line->parsed = true;
+  line->ok = sequence.ComputeInternalRepresentation(text);
+  line->actors = std::move(sequence.actors);
+  line->messages = std::move(sequence.messages);
+}
+
+void Sequence::AddLine(const SequenceLine& line, size_t line_number) {
+  // The line was parsed on its own, as the first line.
+  for (Actor actor : line.actors) {
+    actor.line = line_number;
+    AddActor(actor);
+  }
+  for (Message message : line.messages) {
+    message.line = line_number;
+    messages.push_back(std::move(message));
+  }
 }
 
 std::wstring Sequence::GetText(SequenceParser::TextContext* text) {
@@ -555,6 +777,7 @@ void Sequence::LayoutComputeActorsPositions() {
   bool modified = true;
   int i = 0;
   while (modified) {
+    BudgetStep(spaces.size());
     modified = false;
     for (const ActorSpace& s : spaces) {
       if (actors[s.b].center - actors[s.a].center < s.space) {
@@ -563,7 +786,8 @@ void Sequence::LayoutComputeActorsPositions() {
       }
     }
     if (i++ > 500) {
-      std::cerr << "Something went wrong!" << std::endl;
+      ReportDiagnostic(
+          {"sequence-layout", 0, 0, "The actors positions didn't converge"});
       break;
     }
   }
@@ -684,7 +908,7 @@ void Sequence::LayoutComputeMessagesPositions() {
             });
 }
 
-std::string Sequence::Draw() {
+void Sequence::Draw(Scene* scene) {
   // Estimate output dimension.
   int width = actors.back().right;
   int height = 0;
@@ -693,17 +917,13 @@ std::string Sequence::Draw() {
   }
   height += 4;
 
-  Screen screen(width, height);
+  scene->Resize(width, height);
 
   for (auto& actor : actors)
-    actor.Draw(screen, height);
+    actor.Draw(*scene, height);
 
   for (auto message : messages)
-    message.Draw(screen);
-
-  if (ascii_only_)
-    screen.ASCIIfy(0);
-  return screen.ToString();
+    message.Draw(*scene);
 }
 
 std::unique_ptr<Translator> SequenceTranslator() {
@@ -713,6 +933,8 @@ std::unique_ptr<Translator> SequenceTranslator() {
 std::string Sequence::Highlight(const std::string& input) {
   std::stringstream out;
 
+  // Lexers and parsers share caches. See |AntlrMutex|.
+  std::lock_guard<std::mutex> lock(AntlrMutex());
   antlr4::ANTLRInputStream input_stream(input);
 
   // Lexer.
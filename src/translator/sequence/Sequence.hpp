@@ -3,6 +3,7 @@
 // the LICENSE file.
 
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -10,7 +11,8 @@
 #include "translator/sequence/SequenceLexer.h"
 #include "translator/sequence/SequenceParser.h"
 
-class Screen;
+class Scene;
+class Sink;
 
 enum class Direction {
   Left,
@@ -29,12 +31,16 @@ struct Actor {
   std::wstring name;
   std::set<Dependency> dependencies;
 
+  // The position of its first declaration. See |Diagnostic|.
+  size_t line = 0;
+  size_t column = 0;
+
   // Computed position.
   int left = 0;
   int center = 0;
   int right = 0;
 
-  void Draw(Screen& screen, int height);
+  void Draw(Scene& scene, int height);
 };
 
 struct Message {
@@ -46,6 +52,10 @@ struct Message {
 
   Direction direction = Direction::Right;
 
+  // The position in the input. See |Diagnostic|.
+  size_t line = 0;
+  size_t column = 0;
+
   // Computed position.
   int left = 0;
   int right = 0;
@@ -59,7 +69,7 @@ struct Message {
   bool is_separated = false;
   int offset = 0;
 
-  void Draw(Screen& screen);
+  void Draw(Scene& scene);
 };
 
 // Define minimum space between two actors.
@@ -82,22 +92,47 @@ struct MessageSetWithWeight {
   }
 };
 
+// The commands of one line of input. Sessions parse every line on its own, and
+// only the lines damaged by an edit again. See |SequenceSession|.
+struct SequenceLine {
+  // The size of the line, without its '\n'.
+  size_t size = 0;
+  bool parsed = false;
+  bool ok = true;
+  std::vector<Actor> actors;
+  std::vector<Message> messages;
+};
+
 class Sequence : public Translator {
  public:
   virtual ~Sequence() = default;
 
  private:
-  // 1) Parse.
-  void ComputeInternalRepresentation(const std::string& input);
+  // Lay |input| out. The state of the translation is stored in |this|, which
+  // must be freshly constructed.
+  std::unique_ptr<TranslationLayout> Process(const std::string& input,
+                                             const OptionSet& options);
+  // Lay the parsed commands out.
+  std::unique_ptr<TranslationLayout> ProcessRepresentation(
+      const OptionSet& options);
+
+  // 1) Parse. Returns false when |input| isn't valid.
+  bool ComputeInternalRepresentation(const std::string& input);
   void AddCommand(SequenceParser::CommandContext* command);
   void AddMessageCommand(SequenceParser::MessageCommandContext* message);
   void AddDependencyCommand(
       SequenceParser::DependencyCommandContext* actor_context);
+  void AddActor(const Actor& actor);
   int GetNumber(SequenceParser::NumberContext* number);
   std::wstring GetText(SequenceParser::TextContext* text);
 
+  // 1') Parse a single line, and add the commands of a parsed line, which is
+  // the |line_number|-th line of the input.
+  static void ParseLine(const std::string& text, SequenceLine* line);
+  void AddLine(const SequenceLine& line, size_t line_number);
+
   // 1.1) Check input validity.
-  bool ContainsSelfMessage();
+  void RemoveSelfMessages();
 
   // 2) Clean the representation.
   void UniformizeInternalRepresentation();
@@ -112,24 +147,33 @@ class Sequence : public Translator {
   void LayoutComputeMessagesPositions();
 
   // 4)
-  std::string Draw();
-  std::string output_;
+  void Draw(Scene* scene);
 
   const char* Name() final;
   const char* Identifier() final;
   const char* Description() final;
-  std::vector<OptionDescription> Options() final;
+  std::vector<OptionDescription> Options() const final;
   std::vector<Example> Examples() final;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) override;
+                        const OptionSet& options) const override;
+  void TranslateTo(const std::string& input,
+                   const OptionSet& options,
+                   Sink* sink) const override;
+  std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const override;
+  std::unique_ptr<TranslationSession> OpenSession(
+      const std::string& input,
+      const OptionSet& options) const override;
   std::string Highlight(const std::string& input) override;
 
+  friend class SequenceSession;
+
   std::vector<Actor> actors;
   std::vector<Message> messages;
 
   std::map<std::wstring, int> actor_index;
   std::map<int, int> message_index;
 
-  bool ascii_only_;
   bool interpret_backslash_n_ = false;
 };
@@ -2,11 +2,15 @@
 // Use of this source code is governed by the MIT license that can be found in
 // the LICENSE file.
 
+#include <map>
 #include <memory>
-#include <sstream>
+#include <string_view>
 #include <vector>
 
+#include "screen/DrawList.h"
+#include "screen/InternedRows.h"
 #include "screen/Screen.h"
+#include "screen/Sink.h"
 #include "translator/Translator.h"
 
 namespace {
@@ -35,7 +39,7 @@ namespace {
     int height[4];
   };
   
-  std::map<std::string, Style> styles = {
+  const std::map<std::string, Style> styles = {
     {
       "ascii",
       Style{
@@ -364,6 +368,199 @@ namespace {
 };
 // clang-format on
 
+// Split |input| around |delimiter|, the way successive std::getline calls
+// would: the last piece is dropped when empty.
+std::vector<std::wstring_view> Split(std::wstring_view input,
+                                     wchar_t delimiter) {
+  std::vector<std::wstring_view> out;
+  size_t start = 0;
+  while (start < input.size()) {
+    size_t end = input.find(delimiter, start);
+    if (end == std::wstring_view::npos)
+      end = input.size();
+    out.push_back(input.substr(start, end - start));
+    start = end + 1;
+  }
+  return out;
+}
+
+// Draw |size| characters of |corner|, starting at |i|. Past the end of
+// |corner|, the cells are set to L'\0', like |corner[i]| would give.
+void DrawCorner(DrawList* draw_list,
+                int x,
+                int y,
+                std::wstring_view corner,
+                size_t i,
+                int size) {
+  std::wstring_view part = corner.substr(std::min(i, corner.size()), size);
+  draw_list->DrawText(x, y, part);
+  draw_list->FillSpan(x + int(part.size()), y, size - int(part.size()), L'\0');
+}
+
+// The cells of a table, and the width of its columns. They are drawn in the
+// style selected at rasterization.
+class TableLayout : public TranslationLayout {
+ public:
+  void Rasterize(const OptionSet& options, Sink* sink) const override;
+
+  std::vector<std::vector<std::wstring>> data;
+  std::vector<int> column_width;
+};
+
+void TableLayout::Rasterize(const OptionSet& options, Sink* sink) const {
+  // Style.
+  auto style_it = styles.find(options.Get("style"));
+  const Style& style =
+      style_it != styles.end() ? style_it->second : styles.at("unicode");
+
+  const int row_count = data.size();
+  const int column_count = column_width.size();
+
+  // Compute sum_column_width;
+  int column_width_global = 0;
+  for (const auto it : column_width) {
+    column_width_global += it;
+  }
+
+  // Compute screen dimension.
+  int width = style.width[0] + style.width[1] * (column_count - 1) +
+              style.width[2] + column_width_global;
+  int height = style.height[0] + style.height[1] +
+               style.height[2] * (row_count - 2) + style.height[3] +
+               row_count;
+
+  Screen screen(width, height);
+
+  // Draw table. The spans of every row of the table are recorded, then drawn
+  // row by row, while the rows are still in cache.
+  DrawList draw_list;
+  int Y = 0;
+  for (int y = 0; y < row_count; ++y) {
+    bool last_line = (y == row_count - 1);
+    int X = 0;
+
+    const int cell_top = Y + style.height[std::min(2, y)];
+    const int cell_bottom = cell_top + 1;
+
+    for (int x = 0; x < data[y].size(); ++x) {
+      bool last_row = (x == column_count - 1);
+      // clang-format off
+      const int top_char = 
+        y == 0 ? 1 :
+        y == 1 ? 8 :
+                 15;
+      const int left_char =
+        y == 0 ? (x == 0 ? 4 : 5) :
+                 (x == 0 ? 11:12) ;
+      const int right_char = 
+        y == 0 ? 6:
+                 13;
+      const int bottom_char = 19;
+      const int top_left_char =
+          y == 0 ? (x == 0 ? 0 : 2):
+          y == 1 ? (x == 0 ? 7 : 9):
+                   (x == 0 ? 14:16);
+      const int top_right_char =
+          y == 0 ? 3 :
+          y == 1 ? 10:
+                   17;
+      const int bottom_left_char =
+          x == 0 ? 18:
+                   20;
+      const int bottom_right_char = 21;
+
+      const int cell_left = X + style.width[std::min(1,x)];
+      const int cell_right = cell_left + column_width[x];
+
+      // clang-format on
+
+      // Draw Top.
+      {
+        int i = 0;
+        for (int yy = Y; yy < cell_top; ++yy) {
+          draw_list.FillSpan(cell_left, yy, cell_right - cell_left,
+                             style.charset[top_char][i]);
+          ++i;
+        }
+      }
+      // Draw Down.
+      if (last_line) {
+        int i = 0;
+        for (int yy = cell_bottom; yy < height; ++yy) {
+          draw_list.FillSpan(cell_left, yy, cell_right - cell_left,
+                             style.charset[bottom_char][i]);
+          ++i;
+        }
+      }
+
+      // Draw Left.
+      for (int yy = cell_top; yy < cell_bottom; ++yy) {
+        draw_list.DrawText(X, yy, style.charset[left_char]);
+      }
+
+      // Draw Right.
+      if (last_row) {
+        for (int yy = cell_top; yy < cell_bottom; ++yy) {
+          draw_list.DrawText(cell_right, yy, style.charset[right_char]);
+        }
+      }
+
+      // Draw Left/Top
+      {
+        std::wstring_view corner = style.charset[top_left_char];
+        const int corner_width = cell_left - X;
+        int i = 0;
+        for (int yy = Y; yy < cell_top; ++yy) {
+          DrawCorner(&draw_list, X, yy, corner, i, corner_width);
+          i += corner_width;
+        }
+      }
+
+      // Draw Right/Top
+      if (last_row) {
+        std::wstring_view corner = style.charset[top_right_char];
+        const int corner_width = width - cell_right;
+        int i = 0;
+        for (int yy = Y; yy < cell_top; ++yy) {
+          DrawCorner(&draw_list, cell_right, yy, corner, i, corner_width);
+          i += corner_width;
+        }
+      }
+
+      // Draw Left/Bottom
+      if (last_line) {
+        std::wstring_view corner = style.charset[bottom_left_char];
+        const int corner_width = cell_left - X;
+        int i = 0;
+        for (int yy = cell_bottom; yy < height; ++yy) {
+          DrawCorner(&draw_list, X, yy, corner, i, corner_width);
+          i += corner_width;
+        }
+      }
+
+      // Draw Right/Bottom
+      if (last_row && last_line) {
+        std::wstring_view corner = style.charset[bottom_right_char];
+        const int corner_width = width - cell_right;
+        int i = 0;
+        for (int yy = cell_bottom; yy < height; ++yy) {
+          DrawCorner(&draw_list, cell_right, yy, corner, i, corner_width);
+          i += corner_width;
+        }
+      }
+
+      // Draw Text.
+      draw_list.DrawText(cell_left, cell_top, data[y][x]);
+      X = cell_right;
+    }
+    Y = cell_bottom;
+    draw_list.Replay(&screen);
+  }
+
+  // Separator rows repeat, and are encoded once.
+  InternedRows(screen).Write(sink);
+}
+
 class Table : public Translator {
  public:
   virtual ~Table() = default;
@@ -373,7 +570,7 @@ class Table : public Translator {
   const char* Identifier() final { return "Table"; }
   const char* Description() final { return "Draw table"; }
 
-  std::vector<Translator::OptionDescription> Options() final {
+  std::vector<Translator::OptionDescription> Options() const final {
     return {
         {
             "style",
@@ -400,6 +597,14 @@ class Table : public Translator {
             "unicode",
             "The style of the table.",
             Widget::Combobox,
+            /*style=*/true,
+        },
+        {
+            "separator",
+            {},
+            ",",
+            "The character separating the cells. Any single character.",
+            Widget::Combobox,
         },
     };
   }
@@ -413,37 +618,37 @@ class Table : public Translator {
     };
   }
   std::string Translate(const std::string& input,
-                        const std::string& options_string) override {
-    auto options = SerializeOption(options_string);
-
-    // Style.
-    std::string style_option = options["style"];
-    Style style = styles["unicode"];
-    if (styles.count(style_option)) {
-      style = styles[style_option];
-    }
+                        const OptionSet& options) const override {
+    std::string output;
+    TranslateTo(input, options, StringSink(&output).get());
+    return output;
+  }
+
+  void TranslateTo(const std::string& input,
+                   const OptionSet& options,
+                   Sink* sink) const override {
+    ComputeLayout(input, options)->Rasterize(options, sink);
+  }
 
+  std::unique_ptr<TranslationLayout> ComputeLayout(
+      const std::string& input,
+      const OptionSet& options) const override {
     // Separator.
-    std::wstring separator = to_wstring(options["separator"]);
+    std::wstring separator = to_wstring(options.Get("separator"));
     if (separator.size() != 1) {
       separator = L',';
     }
 
     // Parse data.
     std::vector<std::vector<std::wstring>> data;
-    std::wstring line;
-    std::wstringstream ss(to_wstring(input));
-    while (std::getline(ss, line)) {
+    std::wstring input_ws = to_wstring(input);
+    for (std::wstring_view line : Split(input_ws, L'\n')) {
       data.emplace_back();
-      std::wstring cell;
-      std::wstringstream ss_line(line);
-      while (std::getline(ss_line, cell, separator[0])) {
-        data.back().push_back(cell);
-      }
+      for (std::wstring_view cell : Split(line, separator[0]))
+        data.back().emplace_back(cell);
     }
 
-    // Compute row/line count.
-    int row_count = data.size();
+    // Compute column count.
     int column_count = 0;
     for (const auto& line : data) {
       column_count = std::max(column_count, (int)line.size());
@@ -462,147 +667,10 @@ class Table : public Translator {
       }
     }
 
-    // Compute sum_column_width;
-    int column_width_global = 0;
-    for (const auto it : column_width) {
-      column_width_global += it;
-    }
-
-    // Compute screen dimension.
-    int width = style.width[0] + style.width[1] * (column_count - 1) +
-                style.width[2] + column_width_global;
-    int height = style.height[0] + style.height[1] +
-                 style.height[2] * (row_count - 2) + style.height[3] +
-                 row_count;
-
-    Screen screen(width, height);
-
-    // Draw table.
-    int Y = 0;
-    for (int y = 0; y < row_count; ++y) {
-      bool last_line = (y == row_count - 1);
-      int X = 0;
-
-      const int cell_top = Y + style.height[std::min(2, y)];
-      const int cell_bottom = cell_top + 1;
-
-      for (int x = 0; x < data[y].size(); ++x) {
-        bool last_row = (x == column_count - 1);
-        // clang-format off
-        const int top_char = 
-          y == 0 ? 1 :
-          y == 1 ? 8 :
-                   15;
-        const int left_char =
-          y == 0 ? (x == 0 ? 4 : 5) :
-                   (x == 0 ? 11:12) ;
-        const int right_char = 
-          y == 0 ? 6:
-                   13;
-        const int bottom_char = 19;
-        const int top_left_char =
-            y == 0 ? (x == 0 ? 0 : 2):
-            y == 1 ? (x == 0 ? 7 : 9):
-                     (x == 0 ? 14:16);
-        const int top_right_char =
-            y == 0 ? 3 :
-            y == 1 ? 10:
-                     17;
-        const int bottom_left_char =
-            x == 0 ? 18:
-                     20;
-        const int bottom_right_char = 21;
-
-        const int cell_left = X + style.width[std::min(1,x)];
-        const int cell_right = cell_left + column_width[x];
-
-        // clang-format on
-
-        // Draw Top.
-        {
-          int i = 0;
-          for (int yy = Y; yy < cell_top; ++yy) {
-            for (int xx = cell_left; xx < cell_right; ++xx) {
-              screen.DrawPixel(xx, yy, style.charset[top_char][i]);
-            }
-            ++i;
-          }
-        }
-        // Draw Down.
-        if (last_line) {
-          int i = 0;
-          for (int yy = cell_bottom; yy < height; ++yy) {
-            for (int xx = cell_left; xx < cell_right; ++xx) {
-              screen.DrawPixel(xx, yy, style.charset[bottom_char][i]);
-            }
-            ++i;
-          }
-        }
-
-        // Draw Left.
-        for (int yy = cell_top; yy < cell_bottom; ++yy) {
-          screen.DrawText(X, yy, style.charset[left_char]);
-        }
-
-        // Draw Right.
-        if (last_row) {
-          for (int yy = cell_top; yy < cell_bottom; ++yy) {
-            screen.DrawText(cell_right, yy, style.charset[right_char]);
-          }
-        }
-
-        // Draw Left/Top
-        {
-          int i = 0;
-          for (int yy = Y; yy < cell_top; ++yy) {
-            for (int xx = X; xx < cell_left; ++xx) {
-              screen.DrawPixel(xx, yy, style.charset[top_left_char][i]);
-              ++i;
-            }
-          }
-        }
-
-        // Draw Right/Top
-        if (last_row) {
-          int i = 0;
-          for (int yy = Y; yy < cell_top; ++yy) {
-            for (int xx = cell_right; xx < width; ++xx) {
-              screen.DrawPixel(xx, yy, style.charset[top_right_char][i]);
-              ++i;
-            }
-          }
-        }
-
-        // Draw Left/Bottom
-        if (last_line) {
-          int i = 0;
-          for (int yy = cell_bottom; yy < height; ++yy) {
-            for (int xx = X; xx < cell_left; ++xx) {
-              screen.DrawPixel(xx, yy, style.charset[bottom_left_char][i]);
-              ++i;
-            }
-          }
-        }
-
-        // Draw Right/Bottom
-        if (last_row && last_line) {
-          int i = 0;
-          for (int yy = cell_bottom; yy < height; ++yy) {
-            for (int xx = cell_right; xx < width; ++xx) {
-              screen.DrawPixel(xx, yy, style.charset[bottom_right_char][i]);
-              ++i;
-            }
-          }
-        }
-
-        // Draw Text.
-        screen.DrawText(cell_left, cell_top, data[y][x]);
-        X = cell_right;
-      }
-      Y = cell_bottom;
-    }
-
-    return screen.ToString();
+    auto layout = std::make_unique<TableLayout>();
+    layout->data = std::move(data);
+    layout->column_width = std::move(column_width);
+    return layout;
   }
 };
 
@@ -4,11 +4,12 @@
 
 #include <algorithm>
 #include <functional>
-#include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <vector>
 
+#include "screen/Connection.h"
 #include "screen/Screen.h"
 #include "translator/Translator.h"
 
@@ -200,48 +201,30 @@ DisplayTree MergeDisplayTree(std::wstring content,
     }
   }
 
+  // Collect the connections of the connector column, then draw it at once.
+  std::vector<int> connector(ret.content.size(), 0);
+  for (int y = first_entrance; y <= last_entrance; ++y) {
+    connector[y] = (y > first_entrance ? kUp : 0) |  //
+                   (y < last_entrance ? kDown : 0);
+  }
+
   int y = 0;
   for (auto& child : children) {
-    int start = y;
-
-    // Draw Child vertical connector.
-    for (auto& line : child.content) {
-      (void)line;
-      if (y >= first_entrance && y <= last_entrance) {
-        ret.content[y][content.size() + 1] = L'│';
-      }
-      ++y;
-    }
-
-    // Refine connector on child entrance points.
-    int child_entrance = start + child.entrance;
-    auto& connector = ret.content[child_entrance][content.size() + 1];
-    if (first_entrance == last_entrance)
-      connector = L'─';
-    else if (child_entrance == first_entrance)
-      connector = L'┌';
-    else if (child_entrance < last_entrance)
-      connector = L'├';
-    else
-      connector = L'└';
+    int child_entrance = y + child.entrance;
+    connector[child_entrance] |= kRight;
 
     // Draw connector to child entrance.
     ret.content[child_entrance][content.size() + 2] = L'─';
+    y += child.content.size();
   }
 
   // Draw parent entrance to connector.
   ret.content[ret.entrance][content.size() + 0] = L'─';
-  // Refine connector on parent entrance points.
-  auto& connector = ret.content[ret.entrance][content.size() + 1];
-  // clang-format off
-  switch (connector) {
-    case L'─': connector = L'─'; break;
-    case L'┌': connector = L'┬'; break;
-    case L'├': connector = L'┼'; break;
-    case L'└': connector = L'┴'; break;
-    case L'│': connector = L'┤'; break;
-  }
-  // clang-format on
+  if (connector[ret.entrance])
+    connector[ret.entrance] |= kLeft;
+
+  for (int y = first_entrance; y <= last_entrance; ++y)
+    ret.content[y][content.size() + 1] = ConnectionGlyph(connector[y]);
 
   return ret;
 }
@@ -298,11 +281,9 @@ class Tree : public Translator {
  public:
   virtual ~Tree() = default;
   std::string Translate(const std::string& input,
-                        const std::string& options_string) override {
-    auto options = SerializeOption(options_string);
-
+                        const OptionSet& options) const override {
     // Style.
-    std::string style_option = options["style"];
+    const std::string& style_option = options.Get("style");
 
     // Parse the tree.
     std::vector<Line> lines;
@@ -364,7 +345,7 @@ class Tree : public Translator {
   const char* Identifier() final { return "Tree"; }
   const char* Description() final { return "Draw a tree"; }
 
-  std::vector<Translator::OptionDescription> Options() final {
+  std::vector<Translator::OptionDescription> Options() const final {
     return {
         {
             "style",
@@ -378,7 +359,7 @@ class Tree : public Translator {
                 "unicode right center",
                 "unicode right bottom",
             },
-            "unicode 1",
+            "unicode 2",
             "The style of the tree.",
         },
     };
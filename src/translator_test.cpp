@@ -0,0 +1,266 @@
+// Copyright 2023 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
+// the LICENSE file.
+
+// Tests of the Translator API the input/output tests don't go through.
+
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "translator/Factory.h"
+#include "translator/Translator.h"
+
+namespace {
+
+int failures = 0;
+
+void Expect(const std::string& name,
+            const std::string& output,
+            const std::string& expected) {
+  if (output == expected)
+    return;
+  ++failures;
+  std::cout << "  [FAIL] " << name << std::endl;
+  std::cout << "---[Output]------------------" << std::endl;
+  std::cout << output << std::endl;
+  std::cout << "---[Expected]----------------" << std::endl;
+  std::cout << expected << std::endl;
+}
+
+// The errors of |options|, one per line.
+std::string Errors(const OptionSet& options) {
+  std::string output;
+  for (const std::string& error : options.errors())
+    output += error + "\n";
+  return output;
+}
+
+const std::vector<Translator::OptionDescription> kDescriptions = {
+    {
+        "style",
+        {"unicode", "ascii"},
+        "unicode",
+        "The style.",
+        Translator::Widget::Combobox,
+        /*style=*/true,
+    },
+    {
+        "name",
+        {},
+        "none",
+        "Any value.",
+        Translator::Widget::Combobox,
+    },
+    {
+        "flag",
+        {"true", "false"},
+        "false",
+        "A checkbox.",
+        Translator::Widget::Checkbox,
+    },
+};
+
+void TestOptionSet() {
+  OptionSet defaults(kDescriptions, "");
+  Expect("Defaults: errors", Errors(defaults), "");
+  Expect("Defaults", defaults.Serialize(),
+         "style\nunicode\nname\nnone\nflag\nfalse\n");
+  Expect("Defaults: layout key", defaults.LayoutKey(),
+         "name\nnone\nflag\nfalse\n");
+  Expect("Defaults: flag", std::to_string(defaults.GetBool("flag")), "0");
+
+  OptionSet values(kDescriptions, "flag\ntrue\nstyle\nascii\nname\nfoo\n");
+  Expect("Values: errors", Errors(values), "");
+  Expect("Values: style", values.Get("style"), "ascii");
+  Expect("Values: free value", values.Get("name"), "foo");
+  Expect("Values: flag", std::to_string(values.GetBool("flag")), "1");
+  Expect("Values: order", values.Serialize(),
+         "style\nascii\nname\nfoo\nflag\ntrue\n");
+
+  // The last value wins. The trailing newline is optional.
+  OptionSet last(kDescriptions, "style\nascii\nstyle\nunicode");
+  Expect("Last value: errors", Errors(last), "");
+  Expect("Last value", last.Get("style"), "unicode");
+
+  // Errors keep the default value, and don't stop the parsing.
+  OptionSet errors(kDescriptions,
+                   "styl\nascii\nstyle\nASCII\nflag\nyes\nname\nfoo\n");
+  Expect("Errors: ok", std::to_string(errors.ok()), "0");
+  Expect("Errors", Errors(errors),
+         "Unknown option: styl\n"
+         "Invalid value for option style: ASCII\n"
+         "Invalid value for option flag: yes\n");
+  Expect("Errors: values", errors.Serialize(),
+         "style\nunicode\nname\nfoo\nflag\nfalse\n");
+
+  Expect("Undeclared option", errors.Get("styl"), "");
+  Expect("Undeclared flag", std::to_string(errors.GetBool("styl")), "0");
+
+  // Option strings differing by order, defaults or errors are equal.
+  OptionSet reordered(kDescriptions, "name\nfoo\nunknown\nvalue\n");
+  Expect("Equal serializations", reordered.Serialize(), errors.Serialize());
+}
+
+// Every declared option accepts its default value, and rejects values outside
+// of its list.
+void TestDeclaredOptions() {
+  for (Translator* translator : TranslatorList()) {
+    const std::string name = translator->Identifier();
+    for (const auto& description : translator->Options()) {
+      OptionSet options = translator->CompileOptions(
+          description.name + "\n" + description.default_value + "\n");
+      Expect(name + " " + description.name + ": default", Errors(options), "");
+      if (description.values.empty())
+        continue;
+      options = translator->CompileOptions(description.name + "\ninvalid\n");
+      Expect(name + " " + description.name + ": invalid", Errors(options),
+             "Invalid value for option " + description.name + ": invalid\n");
+      Expect(name + " " + description.name + ": fallback",
+             options.Get(description.name), description.default_value);
+    }
+  }
+}
+
+// Table's separator accepts any single character, and falls back to the comma
+// otherwise.
+void TestTableSeparator() {
+  Translator* table = FindTranslator("Table");
+  const std::string expected = table->Translate("a,b\nc,d", "");
+  for (const std::string separator : {":", " ", "\t", "é"}) {
+    OptionSet options = table->CompileOptions("separator\n" + separator + "\n");
+    Expect("Table separator '" + separator + "': errors", Errors(options), "");
+    std::string input = "a" + separator + "b\nc" + separator + "d";
+    Expect("Table separator '" + separator + "'",
+           table->Translate(input, options), expected);
+  }
+  for (const std::string separator : {"::", ", "}) {
+    OptionSet options = table->CompileOptions("separator\n" + separator + "\n");
+    Expect("Table separator '" + separator + "': errors", Errors(options), "");
+    Expect("Table separator '" + separator + "': fallback",
+           table->Translate("a,b\nc,d", options), expected);
+  }
+}
+
+// The option sets to translate the examples with: the default one, and one per
+// value of every option.
+std::vector<OptionSet> OptionVariations(Translator* translator) {
+  std::vector<OptionSet> options = {translator->CompileOptions("")};
+  for (const auto& description : translator->Options()) {
+    for (const std::string& value : description.values) {
+      options.push_back(
+          translator->CompileOptions(description.name + "\n" + value + "\n"));
+    }
+  }
+  return options;
+}
+
+// |TranslateMany| gives the outputs of |Translate|, for the translators sharing
+// a layout between their styles.
+void TestTranslateMany() {
+  for (Translator* translator : TranslatorList()) {
+    const std::string name = translator->Identifier();
+    const std::vector<OptionSet> options = OptionVariations(translator);
+    for (const auto& example : translator->Examples()) {
+      if (!translator->ComputeLayout(example.input, options[0]))
+        break;
+      std::vector<std::string> outputs =
+          translator->TranslateMany(example.input, options);
+      for (size_t i = 0; i < options.size(); ++i) {
+        Expect("TranslateMany: " + name + " " + example.title + " " +
+                   options[i].Serialize(),
+               outputs[i], translator->Translate(example.input, options[i]));
+      }
+    }
+  }
+}
+
+// The output of |translate|, followed by its diagnostics and the exception it
+// threw, if any.
+std::string Result(const std::function<std::string()>& translate) {
+  std::vector<Diagnostic> diagnostics;
+  std::string output;
+  {
+    ScopedDiagnostics scoped_diagnostics(&diagnostics);
+    try {
+      output = translate();
+    } catch (const std::exception& error) {
+      output = std::string("exception: ") + error.what();
+    }
+  }
+  for (const Diagnostic& diagnostic : diagnostics)
+    output += "\n" + diagnostic.code + " " + ToString(diagnostic);
+  return output;
+}
+
+// A session edited at random renders the translation of its current input.
+// The input is typed toward an example, with some edits undone and some
+// unrelated text inserted.
+void TestSessions() {
+  const char* const kInsertions[] = {
+      "\n", " ", ":", ";", "->", " -> ", "A", "1", "\"", "(", ")",
+      "{",  "}", "[", "]",  ",",  "|",    "/", "*", "_",  "é",
+  };
+  std::mt19937 random(42);
+  for (Translator* translator : TranslatorList()) {
+    const std::string name = translator->Identifier();
+    const OptionSet options = translator->CompileOptions("");
+    for (const auto& example : translator->Examples()) {
+      const std::string& target = example.input;
+      auto session = translator->OpenSession("", options);
+      for (int step = 0; step < 60 && session->input() != target; ++step) {
+        const std::string& input = session->input();
+        size_t typed = 0;
+        while (typed < input.size() && typed < target.size() &&
+               input[typed] == target[typed]) {
+          ++typed;
+        }
+        switch (random() % 4) {
+          case 0:
+          case 1:
+            // Type the next characters of the example.
+            session->SetInput(target.substr(0, typed + 1 + random() % 20));
+            break;
+          case 2:
+            session->ApplyEdit(random() % (input.size() + 1), random() % 5,
+                               "");
+            break;
+          default:
+            session->ApplyEdit(random() % (input.size() + 1), 0,
+                               kInsertions[random() % std::size(kInsertions)]);
+            break;
+        }
+
+        const std::string& edited = session->input();
+        const std::string expected = Result(
+            [&] { return translator->Translate(edited, options); });
+        Expect("Session: " + name + " " + example.title + "\n" + edited,
+               Result([&] { return session->Render(); }), expected);
+        // A second render reuses what the first one computed.
+        Expect("Session: " + name + " " + example.title + " (again)\n" + edited,
+               Result([&] { return session->Render(); }), expected);
+      }
+
+      session->SetInput(target);
+      Expect("Session: " + name + " " + example.title,
+             Result([&] { return session->Render(); }),
+             Result([&] { return translator->Translate(target, options); }));
+    }
+  }
+}
+
+}  // namespace
+
+int main(int, const char**) {
+  TestOptionSet();
+  TestDeclaredOptions();
+  TestTableSeparator();
+  TestTranslateMany();
+  TestSessions();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}